@@ -0,0 +1,86 @@
+// Per-leaf cost of the utility bound: std::function (as max_f used to be)
+// versus a functor that the leaf kernel is instantiated for (set_util()).
+// The kernel is the leaf loop of PolTreeState::_bound_dfs, without the BN.
+//
+// build and run: make bench_max_f
+
+#include <vector>
+#include <utility>
+#include <functional>
+#include <chrono>
+#include <iostream>
+#include <cstdlib>
+
+#include "../src/utility_functors.h"
+
+using namespace std;
+
+typedef std::function<int(vector< pair<int,int> >&)> UtilFunction;
+
+template<class F>
+__attribute__((noinline))
+double leaf_kernel(const F& f, vector< pair<int,int> >& varsmima, int pos, const vector< pair<int,double> >& probs)
+{
+  double v = 0;
+  pair<int,int> mima = varsmima[pos];
+  for (size_t i=0; i!=probs.size(); i++) {
+    int val = probs[i].first;
+    varsmima[pos].first = val; varsmima[pos].second = val;
+    v += f(varsmima) * probs[i].second;
+  }
+  varsmima[pos] = mima;
+  return v;
+}
+
+template<class F>
+double time_leaves(const F& f, vector< pair<int,int> >& varsmima, int stride, size_t reps, double& ns_per_leaf)
+{
+  vector< pair<int,double> > probs;
+  for (int i=0; i!=4; i++)
+    probs.push_back( make_pair(i, 0.25) );
+  
+  double sum = 0;
+  size_t leaves = 0;
+  auto start = chrono::steady_clock::now();
+  for (size_t r=0; r!=reps; r++) {
+    int pos = stride * (r % (varsmima.size()/stride)) + stride-1; // an AND var
+    sum += leaf_kernel(f, varsmima, pos, probs);
+    leaves += probs.size();
+  }
+  auto stop = chrono::steady_clock::now();
+  ns_per_leaf = chrono::duration<double, nano>(stop - start).count() / leaves;
+  return sum;
+}
+
+template<class F>
+void bench(const char* name, const F& functor, size_t numStages, int stride, size_t reps)
+{
+  vector< pair<int,int> > varsmima(numStages*stride);
+  for (size_t i=0; i!=varsmima.size(); i++)
+    varsmima[i] = make_pair(0, 1 + rand()%10);
+  
+  UtilFunction erased = functor;
+  double ns_erased, ns_functor;
+  double s1 = time_leaves(erased, varsmima, stride, reps, ns_erased);
+  double s2 = time_leaves(functor, varsmima, stride, reps, ns_functor);
+  
+  cout << name << " (" << numStages << " stages):"
+       << " std::function " << ns_erased << " ns/leaf,"
+       << " functor " << ns_functor << " ns/leaf,"
+       << " speedup " << ns_erased/ns_functor
+       << (s1 == s2 ? "" : " (RESULTS DIFFER!)") << "\n";
+}
+
+int main(int argc, char** argv)
+{
+  size_t reps = 2000000;
+  if (argc > 1)
+    reps = atol(argv[1]);
+  
+  for (size_t n : {5, 10, 20}) {
+    bench("knapsack", KnapsackUtil(n), n, 3, reps);
+    bench("book    ", BookUtil(n), n, 2, reps);
+    bench("inv2    ", Inv2Util(n), n, 4, reps);
+  }
+  return 0;
+}
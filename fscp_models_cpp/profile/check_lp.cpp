@@ -0,0 +1,419 @@
+// Checks of the LP bound: DenseLP against known optima (by vertex
+// enumeration), including infeasible, degenerate and warm-started LPs, and
+// the relaxations of lp_relaxations.h against the exact utility of every
+// feasible scenario of the toy instances. Needs no Gecode nor circuit.
+//
+// build and run: make check_lp
+
+#include <vector>
+#include <utility>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+
+#include "../src/lp_relaxations.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool ok, const char* what)
+{
+  if (!ok) {
+    failures++;
+    cout << "FAIL: " << what << endl;
+  }
+}
+
+// an LP as given to DenseLP, to solve it by other means too
+struct LP {
+  int n;
+  vector<double> obj, lo, up;
+  vector< vector<double> > rows;
+  vector<double> rhs;
+
+  void load(DenseLP& lp) const {
+    lp.reset(n);
+    for (int j=0; j!=n; j++) {
+      lp.set_bounds(j, lo[j], up[j]);
+      lp.set_obj(j, obj[j]);
+    }
+    for (size_t i=0; i!=rows.size(); i++) {
+      int r = lp.add_row(rhs[i]);
+      for (int j=0; j!=n; j++)
+        lp.coef(r, j) = rows[i][j];
+    }
+  }
+};
+
+// reference: best vertex, where n of the rows and bounds are tight;
+// false if there is none (infeasible, as the bounds are finite)
+static bool vertex_max(const LP& p, double& best)
+{
+  // all constraints as a.x <= b
+  vector< vector<double> > A(p.rows);
+  vector<double> b(p.rhs);
+  for (int j=0; j!=p.n; j++) {
+    vector<double> e(p.n, 0);
+    e[j] = 1;
+    A.push_back(e); b.push_back(p.up[j]);
+    e[j] = -1;
+    A.push_back(e); b.push_back(-p.lo[j]);
+  }
+  int m = A.size(), n = p.n;
+  bool found = false;
+  vector<int> pick(n);
+  for (int i=0; i!=n; i++)
+    pick[i] = i;
+  while (true) {
+    // solve the picked constraints as equalities (Gauss, partial pivoting)
+    vector< vector<double> > M(n, vector<double>(n+1));
+    for (int i=0; i!=n; i++) {
+      for (int j=0; j!=n; j++)
+        M[i][j] = A[pick[i]][j];
+      M[i][n] = b[pick[i]];
+    }
+    bool singular = false;
+    for (int c=0; c!=n && !singular; c++) {
+      int r = c;
+      for (int i=c+1; i!=n; i++)
+        if (fabs(M[i][c]) > fabs(M[r][c]))
+          r = i;
+      if (fabs(M[r][c]) < 1e-9) {
+        singular = true;
+        break;
+      }
+      swap(M[r], M[c]);
+      for (int i=0; i!=n; i++) {
+        if (i == c)
+          continue;
+        double f = M[i][c] / M[c][c];
+        for (int j=c; j!=n+1; j++)
+          M[i][j] -= f*M[c][j];
+      }
+    }
+    if (!singular) {
+      vector<double> x(n);
+      for (int j=0; j!=n; j++)
+        x[j] = M[j][n] / M[j][j];
+      bool feasible = true;
+      for (int i=0; i!=m && feasible; i++) {
+        double v = 0;
+        for (int j=0; j!=n; j++)
+          v += A[i][j]*x[j];
+        feasible = (v <= b[i] + 1e-7);
+      }
+      if (feasible) {
+        double v = 0;
+        for (int j=0; j!=n; j++)
+          v += p.obj[j]*x[j];
+        if (!found || v > best)
+          best = v;
+        found = true;
+      }
+    }
+    // next combination
+    int i = n-1;
+    while (i >= 0 && pick[i] == m-n+i)
+      i--;
+    if (i < 0)
+      break;
+    pick[i]++;
+    for (int k=i+1; k!=n; k++)
+      pick[k] = pick[k-1]+1;
+  }
+  return found;
+}
+
+// DenseLP (lp, possibly warm) agrees with the vertex enumeration
+static bool agrees(DenseLP& lp, const LP& p)
+{
+  double v = 0, ref = 0;
+  p.load(lp);
+  DenseLP::Status st = lp.solve(v);
+  bool feasible = vertex_max(p, ref);
+  if (!feasible)
+    return st == DenseLP::INFEASIBLE;
+  return st == DenseLP::OPTIMAL && fabs(v - ref) <= 1e-6 * (1 + fabs(ref));
+}
+
+static LP box(int n, double lo, double up)
+{
+  LP p;
+  p.n = n;
+  p.obj.assign(n, 0);
+  p.lo.assign(n, lo);
+  p.up.assign(n, up);
+  return p;
+}
+
+static void add(LP& p, const vector<double>& row, double rhs)
+{
+  p.rows.push_back(row);
+  p.rhs.push_back(rhs);
+}
+
+static void check_dense_lp()
+{
+  double v = 0;
+  {
+    // max x+y s.t. x+2y <= 4, 3x+y <= 6: 2.8 at (1.6,1.2)
+    LP p = box(2, 0, 10);
+    p.obj[0] = 1; p.obj[1] = 1;
+    add(p, {1, 2}, 4);
+    add(p, {3, 1}, 6);
+    DenseLP lp;
+    p.load(lp);
+    check(lp.solve(v) == DenseLP::OPTIMAL && fabs(v - 2.8) < 1e-9, "optimum of a 2x2 LP");
+  }
+  {
+    // x + y <= -1 with x,y >= 0
+    LP p = box(2, 0, 1);
+    p.obj[0] = 1;
+    add(p, {1, 1}, -1);
+    DenseLP lp;
+    p.load(lp);
+    check(lp.solve(v) == DenseLP::INFEASIBLE, "infeasible row");
+    // x >= 2 on [0,1], on the same (warm) object
+    LP q = box(1, 0, 1);
+    q.obj[0] = 1;
+    add(q, {-1}, -2);
+    q.load(lp);
+    check(lp.solve(v) == DenseLP::INFEASIBLE, "infeasible bound");
+  }
+  {
+    // unbounded direction (x, y up along x - y <= 1): the box is the
+    // only limit, DenseLP has finite bounds so UNBOUNDED does not occur
+    LP p = box(2, 0, 1e6);
+    p.obj[0] = 1; p.obj[1] = 1;
+    add(p, {1, -1}, 1);
+    DenseLP lp;
+    p.load(lp);
+    check(lp.solve(v) == DenseLP::OPTIMAL && fabs(v - 2e6) < 1e-3, "unbounded direction stops at the box");
+  }
+  {
+    // degenerate: five constraints tight at the optimum (1,1)
+    LP p = box(2, 0, 1);
+    p.obj[0] = 1; p.obj[1] = 1;
+    add(p, {1, 1}, 2);
+    add(p, {1, -1}, 0);
+    add(p, {-1, 1}, 0);
+    DenseLP lp;
+    p.load(lp);
+    check(lp.solve(v) == DenseLP::OPTIMAL && fabs(v - 2) < 1e-9, "degenerate vertex");
+    // Beale's example, cycles with the textbook rule, not with Bland's
+    LP q = box(4, 0, 100);
+    q.obj = {0.75, -20, 0.5, -6};
+    add(q, {0.25, -8, -1, 9}, 0);
+    add(q, {0.5, -12, -0.5, 3}, 0);
+    add(q, {0, 0, 1, 0}, 1);
+    check(agrees(lp, q), "Beale's cycling example");
+  }
+  {
+    // warm start: same rows and free vars, changed coefficients and rhs
+    LP p = box(3, 0, 5);
+    p.obj = {3, 2, 4};
+    add(p, {1, 1, 2}, 4);
+    add(p, {2, 0, 3}, 5);
+    DenseLP lp;
+    check(agrees(lp, p), "before the warm start");
+    size_t warm = lp.warm_starts;
+    p.rhs[0] = 4.5;
+    p.rows[1][2] = 2.5;
+    check(agrees(lp, p), "warm start after the rows changed");
+    check(lp.warm_starts == warm+1, "the basis is reused");
+    // the old basis is infeasible for a much smaller rhs: solved cold
+    p.rhs[0] = -1;
+    p.rhs[1] = 0.5;
+    p.lo[0] = -2;
+    check(agrees(lp, p), "old basis infeasible after the rows changed");
+  }
+  {
+    // random LPs on one object, so most are warm-started from the previous
+    srand(1);
+    DenseLP lp;
+    LP p = box(3, 0, 1);
+    int bad = 0;
+    for (int it=0; it!=2000; it++) {
+      if (it % 50 == 0) { // new shape now and then
+        int n = 1 + rand()%4;
+        int rows = rand()%4;
+        p = box(n, 0, 1);
+        for (int i=0; i!=rows; i++)
+          add(p, vector<double>(n), 0);
+      }
+      for (int j=0; j!=p.n; j++) {
+        p.obj[j] = rand()%11 - 5;
+        p.lo[j] = rand()%3 - 1;
+        p.up[j] = p.lo[j] + rand()%4; // sometimes fixed
+      }
+      for (size_t i=0; i!=p.rows.size(); i++) {
+        for (int j=0; j!=p.n; j++)
+          p.rows[i][j] = rand()%7 - 3;
+        p.rhs[i] = rand()%9 - 2;
+      }
+      if (!agrees(lp, p))
+        bad++;
+    }
+    check(bad == 0, "random LPs");
+    cout << "random LPs: 2000, warm starts: " << lp.warm_starts << ", pivots: " << lp.pivots << endl;
+  }
+}
+
+// the LP value as PolTreeState::_lp_value uses it; false if infeasible
+template<class R>
+static bool lp_value(const R& relax, const vector< pair<int,int> >& VS, double& v)
+{
+  DenseLP lp;
+  if (!relax(VS, lp)) {
+    v = 1e300; // no relaxation, no bound
+    return true;
+  }
+  DenseLP::Status st = lp.solve(v);
+  if (st == DenseLP::INFEASIBLE)
+    return false;
+  if (st != DenseLP::OPTIMAL)
+    v = 1e300;
+  return true;
+}
+
+// every scenario within the ranges VS, with values from dom (per var)
+template<class F>
+static void scenarios(const vector< pair<int,int> >& VS, const vector< vector<int> >& dom,
+                      vector<int>& x, size_t i, const F& f)
+{
+  if (i == VS.size()) {
+    f(x);
+    return;
+  }
+  for (size_t k=0; k!=dom[i].size(); k++)
+    if (dom[i][k] >= VS[i].first && dom[i][k] <= VS[i].second) {
+      x[i] = dom[i][k];
+      scenarios(VS, dom, x, i+1, f);
+    }
+}
+
+// random nodes: a prefix assigned, the rest narrowed at random
+template<class R, class Feasible, class Util>
+static void check_relaxation(const char* name, const R& relax, const vector< vector<int> >& dom,
+                             const Feasible& feasible, const Util& util)
+{
+  srand(2);
+  int nodes = 0, bad = 0, infeasible = 0;
+  size_t n = dom.size();
+  vector< pair<int,int> > VS(n);
+  vector<int> x(n);
+  for (int it=0; it!=3000; it++) {
+    size_t prefix = rand() % (n+1);
+    for (size_t i=0; i!=n; i++) {
+      const vector<int>& d = dom[i];
+      if (i < prefix) {
+        int v = d[rand() % d.size()];
+        VS[i] = make_pair(v, v);
+      } else {
+        int a = rand() % d.size(), b = rand() % d.size();
+        VS[i] = make_pair(d[min(a,b)], d[max(a,b)]);
+      }
+    }
+    double v = 0;
+    bool lp_feasible = lp_value(relax, VS, v);
+    nodes++;
+    if (!lp_feasible)
+      infeasible++;
+    scenarios(VS, dom, x, 0, [&](const vector<int>& s) {
+      if (!feasible(s))
+        return;
+      if (!lp_feasible || util(s) > v + 1e-6)
+        bad++;
+    });
+  }
+  cout << name << ": " << nodes << " nodes, " << infeasible << " LP infeasible" << endl;
+  check(bad == 0, name);
+}
+
+static void check_relaxations()
+{
+  {
+    // toy_knapsack: x in {0,1}, w in {20,30}, r in {10,20}
+    size_t stages = 3;
+    int capacity = 50;
+    vector< vector<int> > dom;
+    for (size_t i=0; i!=stages; i++) {
+      dom.push_back({0, 1});
+      dom.push_back({20, 30});
+      dom.push_back({10, 20});
+    }
+    check_relaxation("KnapsackLP", KnapsackLP(stages, capacity), dom,
+      [&](const vector<int>& s) {
+        int w = 0;
+        for (size_t i=0; i!=stages; i++)
+          w += s[3*i+1]*s[3*i];
+        return w <= capacity;
+      },
+      [&](const vector<int>& s) {
+        int u = 0;
+        for (size_t i=0; i!=stages; i++)
+          u += s[3*i+2]*s[3*i];
+        return u;
+      });
+  }
+  {
+    // inv2 instance_3: x,y in {0,1}, a in {10..25}, b in {20..35}
+    size_t stages = 3;
+    vector< vector<int> > dom;
+    for (size_t i=0; i!=stages; i++) {
+      dom.push_back({0, 1});
+      dom.push_back({0, 1});
+      dom.push_back({10, 15, 20, 25});
+      dom.push_back({20, 25, 30, 35});
+    }
+    check_relaxation("Inv2LP", Inv2LP(stages), dom,
+      [&](const vector<int>& s) {
+        int slack = 0;
+        for (size_t i=0; i!=stages; i++) {
+          if (s[4*i] == s[4*i+1])
+            return false;
+          slack += s[4*i+2]*s[4*i] - s[4*i+3]*s[4*i+1];
+        }
+        return slack >= 0;
+      },
+      [&](const vector<int>& s) {
+        int u = 0;
+        for (size_t i=0; i!=stages; i++)
+          u += s[4*i+2]*s[4*i] + s[4*i+3]*s[4*i+1];
+        return u;
+      });
+  }
+  {
+    // toy_book: d, p in {100..105}
+    size_t stages = 3;
+    vector< vector<int> > dom;
+    for (size_t i=0; i!=2*stages; i++)
+      dom.push_back({100, 101, 102, 103, 104, 105});
+    check_relaxation("BookLP", BookLP(stages), dom,
+      [&](const vector<int>& s) {
+        int stock = 0;
+        for (size_t i=0; i!=stages; i++) {
+          stock += s[2*i] - s[2*i+1];
+          if (stock < 0)
+            return false;
+        }
+        return true;
+      },
+      [&](const vector<int>& s) {
+        int u = 0;
+        for (size_t i=0; i!=stages; i++)
+          u += (int)(stages-i)*(s[2*i+1] - s[2*i]);
+        return u;
+      });
+  }
+}
+
+int main()
+{
+  check_dense_lp();
+  check_relaxations();
+  if (failures == 0)
+    cout << "all checks passed" << endl;
+  return failures == 0 ? 0 : 1;
+}
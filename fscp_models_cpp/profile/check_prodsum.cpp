@@ -0,0 +1,143 @@
+// Checks ProdSum (constraint_prodsum) against the decomposition it replaces,
+// mult() per product and linear() on the products: on random small
+// instances (negative coefficients, x domains beyond 0/1 that prod_sum
+// forces to 0/1, z a variable or a constant, every relation) both must
+// have exactly the same solutions.
+//
+// build and run: make check_prodsum (also compares the toy runs, see Makefile)
+
+#include <vector>
+#include <set>
+#include <iostream>
+#include <cstdlib>
+
+#include <gecode/int.hh>
+#include <gecode/search.hh>
+
+#include "../src/constraint_prodsum.hpp"
+
+using namespace Gecode;
+using namespace std;
+
+struct Instance {
+  vector<int> c;
+  vector< pair<int,int> > x, y; // domains
+  pair<int,int> z;
+  bool z_var;
+  int k;
+  IntRelType irt;
+};
+
+class Check : public Space {
+public:
+  IntVarArray vars; // x..., y..., z
+  Check(const Instance& in, bool decomposed) : vars(*this, 2*in.c.size()+1) {
+    int n = in.c.size();
+    IntArgs c;
+    IntVarArgs x, y;
+    for (int i=0; i!=n; i++) {
+      vars[i] = IntVar(*this, in.x[i].first, in.x[i].second);
+      vars[n+i] = IntVar(*this, in.y[i].first, in.y[i].second);
+      c << in.c[i];
+      x << vars[i];
+      y << vars[n+i];
+    }
+    vars[2*n] = IntVar(*this, in.z.first, in.z.second);
+    if (!decomposed) {
+      if (in.z_var)
+        prod_sum(*this, c, x, y, in.irt, vars[2*n]);
+      else
+        prod_sum(*this, c, x, y, in.irt, in.k);
+    } else {
+      IntVarArgs t;
+      for (int i=0; i!=n; i++) {
+        rel(*this, x[i], IRT_GQ, 0);
+        rel(*this, x[i], IRT_LQ, 1);
+        IntVar ti(*this, Int::Limits::min, Int::Limits::max);
+        mult(*this, x[i], y[i], ti);
+        t << ti;
+      }
+      if (in.z_var)
+        linear(*this, c, t, in.irt, vars[2*n]);
+      else
+        linear(*this, c, t, in.irt, in.k);
+    }
+    branch(*this, vars, INT_VAR_NONE(), INT_VAL_MIN());
+  }
+  Check(bool share, Check& s) : Space(share, s) {
+    vars.update(*this, share, s.vars);
+  }
+  virtual Space* copy(bool share) {
+    return new Check(share, *this);
+  }
+};
+
+static set< vector<int> > solutions(const Instance& in, bool decomposed)
+{
+  set< vector<int> > sols;
+  Check* root = new Check(in, decomposed);
+  DFS<Check> d(root);
+  delete root;
+  while (Check* s = d.next()) {
+    vector<int> v;
+    for (int i=0; i!=s->vars.size(); i++)
+      v.push_back(s->vars[i].val());
+    sols.insert(v);
+    delete s;
+  }
+  return sols;
+}
+
+static int rnd(int lo, int hi)
+{
+  return lo + rand() % (hi-lo+1);
+}
+
+int main()
+{
+  srand(3);
+  const IntRelType rels[] = { IRT_EQ, IRT_LQ, IRT_GQ, IRT_LE, IRT_GR };
+  int instances = 0, differ = 0, negative = 0, forced = 0;
+  size_t total = 0;
+  for (int it=0; it!=3000; it++) {
+    Instance in;
+    int n = rnd(1, 3);
+    for (int i=0; i!=n; i++) {
+      int c = 0;
+      while (c == 0)
+        c = rnd(-3, 3);
+      in.c.push_back(c);
+      if (c < 0)
+        negative++;
+      int xl = rnd(-1, 1), xu = rnd(xl, 2);
+      if (xl < 0 || xu > 1)
+        forced++;
+      in.x.push_back(make_pair(xl, xu));
+      int yl = rnd(-3, 3);
+      in.y.push_back(make_pair(yl, yl + rnd(0, 4)));
+    }
+    in.z_var = (rand() % 2 == 0);
+    in.irt = rels[rand() % (in.z_var ? 3 : 5)]; // LE and GR only with a constant
+    in.z = (in.z_var ? make_pair(rnd(-20, 0), rnd(0, 20)) : make_pair(0, 0));
+    in.k = rnd(-10, 10);
+
+    set< vector<int> > a = solutions(in, false);
+    set< vector<int> > b = solutions(in, true);
+    instances++;
+    total += a.size();
+    if (a != b) {
+      differ++;
+      if (differ <= 5) {
+        cout << "differ: n=" << n << " z_var=" << in.z_var << " irt=" << in.irt << " k=" << in.k << " c:";
+        for (int i=0; i!=n; i++)
+          cout << " " << in.c[i] << "*[" << in.x[i].first << "," << in.x[i].second << "]*["
+               << in.y[i].first << "," << in.y[i].second << "]";
+        cout << " prod_sum: " << a.size() << " sols, decomposition: " << b.size() << " sols" << endl;
+      }
+    }
+  }
+  cout << "instances: " << instances << " solutions: " << total
+       << " negative coefficients: " << negative << " x forced to 0/1: " << forced
+       << " differ: " << differ << endl;
+  return differ == 0 ? 0 : 1;
+}
@@ -0,0 +1,39 @@
+// Counts the calls to the global operator new, to check that the search
+// does not allocate. Link it in and build the drivers with -DCOUNT_MALLOC.
+
+#include <cstdlib>
+#include <new>
+#include <atomic>
+
+#include "../src/malloc_count.h"
+
+static std::atomic<size_t> nr_allocs(0);
+
+size_t malloc_count()
+{
+  return nr_allocs.load();
+}
+
+void* operator new(size_t size)
+{
+  nr_allocs++;
+  void* p = malloc(size == 0 ? 1 : size);
+  if (p == NULL)
+    throw std::bad_alloc();
+  return p;
+}
+
+void* operator new[](size_t size)
+{
+  return operator new(size);
+}
+
+void operator delete(void* p) noexcept
+{
+  free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+  free(p);
+}
@@ -0,0 +1 @@
+../../fscp_src/adaptive_depth.hpp
\ No newline at end of file
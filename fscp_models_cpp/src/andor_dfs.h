@@ -0,0 +1,229 @@
+#ifndef ANDOR_DFS_H
+#define ANDOR_DFS_H
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdio>
+
+#include <gecode/int.hh>
+#include <gecode/search.hh>
+
+#include "policy_tree_state.h"
+#include "checkpoint_io.hpp"
+
+// Depth-first search over the AND/OR tree, driving the Gecode space
+// directly (option --search 1) instead of through Gecode's DFS engine.
+//
+// The brancher (BranchExpUtil) and PolTreeState do the same work as with
+// DFS: choice() orders the values and computes the bounds, commit() prunes
+// and maintains the policy tree state, and each leaf is passed to
+// PolTreeState::new_leaf(). So the result is identical. The difference is
+// that a leaf is evaluated on the space the search is in, where DFS::next()
+// returns a clone of every leaf for the caller to delete, and the last value
+// of a choice is committed on the parent space itself (no clone).
+// Memory is one space per level of the tree, as DFS with recomputation off.
+// A stop object (e.g. SearchMonitor) is checked at every node, as by DFS.
+//
+// Checkpoints (option --checkpoint): every checkpoint_every seconds, and
+// when stopped, the search frontier is written to a file. That is the path
+// from the root, as the archived choice and the alternative under way at
+// each level, and the policy tree state (PolTreeState::checkpoint_save()).
+// resume() reads it back: the choices are rebuilt from their archives
+// instead of calling choice(), and as they record that their alternative
+// was committed, committing it again is a replay that only redoes the
+// domain change. The search then goes on with the next alternatives.
+template<class Model>
+class AndOrDFS {
+ public:
+  AndOrDFS(Model* root0, PolTreeState& poltree0, int verbose0=0, Gecode::Search::Stop* stop0=NULL,
+           const char* checkpoint_file0=NULL, double checkpoint_every0=0)
+    : root(root0), poltree(poltree0), verbose(verbose0), stop(stop0), halted(false), sols(0),
+      checkpoint_file(checkpoint_file0 != NULL ? checkpoint_file0 : ""), checkpoint_every(checkpoint_every0),
+      next_checkpoint(AdaptiveDepth::now() + checkpoint_every0), checkpoints(0) {}
+
+  // explore the whole tree, returns the number of leaves
+  int solve();
+  Gecode::Search::Statistics statistics() const { return stats; }
+  bool stopped() const { return halted; }
+  // continue from the checkpoint file, false if there is none (or it does not match)
+  bool resume();
+
+ private:
+  Model* root;
+  PolTreeState& poltree;
+  int verbose;
+  Gecode::Search::Stop* stop;
+  Gecode::Search::Options opts; // for stop
+  bool halted;
+  int sols;
+  Gecode::Search::Statistics stats;
+
+  std::string checkpoint_file; // empty for none
+  double checkpoint_every; // seconds, <= 0 for only when stopped
+  double next_checkpoint;
+  size_t checkpoints;
+  struct Level {
+    const Gecode::Choice* ch;
+    unsigned int alt; // under way
+  };
+  vector<Level> path; // of the current node
+  struct SavedLevel {
+    Gecode::Archive choice;
+    unsigned int alt;
+  };
+  vector<SavedLevel> saved; // path to resume, cleared when reached
+
+  void _dfs(Model* s, unsigned long int depth);
+  void _checkpoint();
+};
+
+template<class Model>
+int AndOrDFS<Model>::solve()
+{
+  if (root->status() == Gecode::SS_FAILED) {
+    stats.fail++;
+    return 0;
+  }
+  Model* s = static_cast<Model*>(root->clone());
+  _dfs(s, 1);
+  delete s;
+  // done, nothing to resume: also a file this run resumed from (or that an
+  // earlier run left) without writing one itself
+  if (!halted && !checkpoint_file.empty())
+    std::remove(checkpoint_file.c_str());
+  return sols;
+}
+
+// s is owned by the caller
+template<class Model>
+void AndOrDFS<Model>::_dfs(Model* s, unsigned long int depth)
+{
+  bool resuming = (depth <= saved.size()); // a node on the path to the checkpoint
+  if (!resuming) {
+    saved.clear();
+    if (stop != NULL && stop->stop(stats, opts)) {
+      halted = true;
+      if (!checkpoint_file.empty())
+        _checkpoint();
+      return;
+    }
+    if (checkpoint_every > 0 && !checkpoint_file.empty() && AdaptiveDepth::now() >= next_checkpoint) {
+      _checkpoint();
+      next_checkpoint = AdaptiveDepth::now() + checkpoint_every;
+    }
+    stats.node++;
+    stats.depth = std::max(stats.depth, depth);
+  }
+  Gecode::StatusStatistics st;
+  Gecode::SpaceStatus status = s->status(st);
+  stats.propagate += st.propagate;
+  if (resuming && status != Gecode::SS_BRANCH) {
+    std::cerr << "checkpoint " << checkpoint_file << " does not match the problem\n";
+    halted = true;
+    return;
+  }
+  switch (status) {
+    case Gecode::SS_FAILED:
+      stats.fail++;
+      return;
+    case Gecode::SS_SOLVED:
+      sols++;
+      if (verbose >= 1)
+        s->print(std::cout);
+      poltree.new_leaf(s->vars, s->util);
+      return;
+    case Gecode::SS_BRANCH:
+      break;
+  }
+
+  const Gecode::Choice* ch = (resuming ? s->choice(saved[depth-1].choice) : s->choice());
+  unsigned int n = ch->alternatives();
+  Level l = { ch, (resuming ? saved[depth-1].alt : 0) };
+  path.push_back(l);
+  for (unsigned int a=path.back().alt; a!=n && !halted; a++) {
+    path.back().alt = a;
+    if (a+1 != n) {
+      Model* c = static_cast<Model*>(s->clone());
+      c->commit(*ch, a);
+      _dfs(c, depth+1);
+      delete c;
+    } else { // last value, s is not needed anymore
+      s->commit(*ch, a);
+      _dfs(s, depth+1);
+    }
+  }
+  path.pop_back();
+  delete ch;
+}
+
+// written to a temporary file first, so that a crash leaves the previous one
+template<class Model>
+void AndOrDFS<Model>::_checkpoint()
+{
+  std::string tmp = checkpoint_file + ".tmp";
+  {
+    std::ofstream os(tmp.c_str(), std::ios::binary | std::ios::trunc);
+    ckp_put(os, (unsigned int)0x46534350); // "FSCP"
+    ckp_put(os, (unsigned long int)root->vars.size());
+    poltree.checkpoint_save(os);
+    ckp_put(os, sols);
+    ckp_put(os, stats.node);
+    ckp_put(os, stats.fail);
+    ckp_put(os, stats.depth);
+    ckp_put(os, stats.propagate);
+    ckp_put(os, (unsigned long int)path.size());
+    for (size_t i=0; i!=path.size(); i++) {
+      Gecode::Archive e;
+      path[i].ch->archive(e);
+      ckp_put(os, path[i].alt);
+      ckp_put(os, e.size());
+      for (int j=0; j!=e.size(); j++)
+        ckp_put(os, e[j]);
+    }
+    if (!os) {
+      std::cerr << "cannot write checkpoint " << tmp << "\n";
+      return;
+    }
+  }
+  if (std::rename(tmp.c_str(), checkpoint_file.c_str()) != 0) {
+    std::cerr << "cannot write checkpoint " << checkpoint_file << "\n";
+    return;
+  }
+  checkpoints++;
+  if (verbose >= 0)
+    std::cout << "Checkpoint written to " << checkpoint_file << ": nodes: " << stats.node
+              << " depth: " << path.size() << "\n";
+}
+
+template<class Model>
+bool AndOrDFS<Model>::resume()
+{
+  std::ifstream is(checkpoint_file.c_str(), std::ios::binary);
+  unsigned int magic;
+  unsigned long int nr_vars, depth;
+  if (!ckp_get(is, magic) || magic != 0x46534350 || !ckp_get(is, nr_vars) || nr_vars != (unsigned long int)root->vars.size())
+    return false;
+  if (!poltree.checkpoint_load(is) || !ckp_get(is, sols) || !ckp_get(is, stats.node) || !ckp_get(is, stats.fail) ||
+      !ckp_get(is, stats.depth) || !ckp_get(is, stats.propagate) || !ckp_get(is, depth))
+    return false;
+  saved.resize(depth);
+  for (size_t i=0; i!=depth; i++) {
+    int size;
+    if (!ckp_get(is, saved[i].alt) || !ckp_get(is, size))
+      return false;
+    for (int j=0; j!=size; j++) {
+      unsigned int w;
+      if (!ckp_get(is, w))
+        return false;
+      saved[i].choice.put(w);
+    }
+  }
+  if (verbose >= 0)
+    std::cout << "Resuming from " << checkpoint_file << ": nodes: " << stats.node << " depth: " << depth << "\n";
+  return true;
+}
+
+#endif //ANDOR_DFS_H
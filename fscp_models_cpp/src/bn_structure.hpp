@@ -0,0 +1 @@
+../../fscp_src/bn_structure.hpp
\ No newline at end of file
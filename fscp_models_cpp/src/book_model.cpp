@@ -9,6 +9,8 @@
 
 #include "book_model.h"
 #include "constraint_andall.hpp"
+#include "constraint_exputil.hpp"
+#include "constraint_ranges.hpp"
 #include "brancher_exputil.hpp"
 
 using std::vector;
@@ -72,17 +74,8 @@ BookModel::BookModel(PolTreeState& poltree, Cm_opt& opts) :
   linear(*this, varUtilCoef, vars, IRT_EQ, util);
   
   // for exputil
-  // now manually and store it in BN (C++11 lambda function, yeuy!)
-  poltree.max_f = [numStages](vector< pair<int,int> >& VS){
-    assert(VS.size() == numStages * 2); // V1,S1,V2,S2
-    // return n V1.max - n S1.min + ... + Vnmax - Sn.min
-    int bound = 0;
-    for (size_t i=0; i != numStages; i++){
-      bound -= (numStages-i)*VS[(i*2)].first;
-      bound += (numStages-i)*VS[(i*2)+1].second;
-    }
-    return bound;
-  };
+  // now manually and store it in BN (functor, see utility_functors.h)
+  poltree.set_util(BookUtil(numStages));
   
   // constraint 2:
   // overstock in each stage must be >= 0
@@ -97,7 +90,18 @@ BookModel::BookModel(PolTreeState& poltree, Cm_opt& opts) :
     linear(*this, overstCoef, overstVar, IRT_GQ, 0);
   }
   
+  // for the LP bound, relaxation of constraints 1 and 2 (see lp_relaxations.h)
+  poltree.lp_f = BookLP(numStages);
+  // and for context caching (see contexts.h)
+  poltree.context_f = BookContext(numStages);
+  
   
+  // ranges of the vars for the bounds, kept up to date in the space
+  VarRanges ranges = var_ranges(*this, vars);
+
+  // prune decisions on their bound in propagation (--prop_exputil)
+  exputil_prune(*this, vars, ranges, poltree);
+
   //* branching(Space, vars, poltree, order_or_max, order_and_max, depth_or, depth_and);
   bool order_or_max = false; // default
   if (opts.branch_or == 1)
@@ -105,5 +109,5 @@ BookModel::BookModel(PolTreeState& poltree, Cm_opt& opts) :
   bool order_and_max = true; // default
   if (opts.branch_and == -1)
     order_and_max = false;
-  branch_exputil(*this, vars, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
+  branch_exputil(*this, vars, ranges, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
 }
@@ -0,0 +1 @@
+../../fscp_src/bound_cache.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/bound_pool.hpp
\ No newline at end of file
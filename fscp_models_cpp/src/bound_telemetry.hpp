@@ -0,0 +1 @@
+../../fscp_src/bound_telemetry.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/checkpoint_io.hpp
\ No newline at end of file
@@ -1,10 +1,13 @@
 #include "cm_options.h"
+#include "policy_tree_state.h"
+#include "bn_structure.hpp"
 #include <stdlib.h>
 #include <argp.h>
 
 #include <string>
 #include <sstream>
 #include <iostream>
+#include <algorithm>
 using std::string;
 using std::stringstream;
 using std::cout;
@@ -29,9 +32,32 @@ static struct argp_option options[] = {
   {"verbose",  'v', "NUM",     0,  "Verbosity level" },
   {"depth_or", 'o', "NUM", 0,    "depth to compute bound for OR nodes for (default: 6)"},
   {"depth_and",'p', "NUM", 0,    "depth to compute bound for AND nodes for (default: 2) (-1=disable)"},
-  {"branch_or", 'b', "NUM", 0, "value branching over OR vars: 0=default, -1=min, 1=max"},
+  {"branch_or", 'b', "NUM", 0, "value branching over OR vars: 0=default, -1=min, 1=max, 2=largest bound first (depth 0), 3=largest bound first (depth 1)"},
   {"branch_and", 'c', "NUM", 0, "value branching over AND vars: 0=default, -1=min, 1=max"},
   {"capacity", 't', "NUM", 0, "capacity of knapsack"},
+  {"dense_mb", 'm', "NUM", 0, "memory budget in MB for precomputing all probabilities of the network if they fit (default: 64) (0=disable)"},
+  {"prefetch", 'f', "NUM", 0, "prefetch partials of sibling AND values in a background thread: 0=no (default), 1=yes"},
+  {"bound_cache", 'k', "NUM", 0, "memory budget in MB for caching depth-limited bounds (default: 0=disable)"},
+  {"bound_threads", 'j', "NUM", 0, "number of threads for depth-limited bounds (default: 1)"},
+  {"adaptive", 'A', "NUM", 0, "adapt the bound depths per level to the measured prune rate: 0=no (default), 1=yes"},
+  {"telemetry", 'T', "FILE", 0, "write per-level bound and pruning counters as CSV to FILE"},
+  {"lp_bound", 'L', "NUM", 0, "LP relaxation bound at OR nodes: 0=no (default), 1=LP times pr(evidence), 2=expectation over the next AND node of the LP"},
+  {"threads", 'J', "NUM", 0, "number of search threads, each solving subtrees of the top of the AND/OR tree (default: 1)"},
+  {"c_d", 'C', "NUM", 0, "commit distance for recomputation (default: 8) (0=copy every node)"},
+  {"a_d", 'D', "NUM", 0, "adaptive recomputation distance (default: 2)"},
+  {"search", 'S', "NUM", 0, "search engine: 0=Gecode DFS (default), 1=native AND/OR DFS (no copies of leaves)"},
+  {"context", 'G', "NUM", 0, "cache subproblem values by context (AND/OR search graph): 0=no (default), 1=yes"},
+  {"policy", 'P', "FILE", 0, "write the optimal policy as JSON lines to FILE (sequential search only)"},
+  {"timeout", 'u', "TIME", 0, "stop the search after TIME seconds and report the best policy found (default: -1=no limit)"},
+  {"node_limit", 'N', "NODES", 0, "stop the search after NODES nodes (default: 0=no limit)"},
+  {"report", 'R', "SECS", 0, "report the incumbent, root upper bound and gap every SECS seconds (default: 0=only at the end of a limited search)"},
+  {"nogoods", 'g', "NUM", 0, "record OR values that fail in propagation under a context, and fail them without propagating under sibling AND values: 0=no (default), 1=yes"},
+  {"portfolio", 'F', "SPEC", 0, "run configurations concurrently, the first to finish wins: N (the first N of a built-in list) or depth_or,depth_and,branch_or,branch_and;... "},
+  {"checkpoint", 'K', "FILE", 0, "write checkpoints of the search to FILE (native search, see --search)"},
+  {"checkpoint_every", 'E', "SECS", 0, "seconds between two checkpoints (default: 600, 0=only when stopped)"},
+  {"resume", 'Z', "NUM", 0, "continue from the checkpoint in --checkpoint FILE: 0=no (default), 1=yes"},
+  {"progress", 'Q', "FILE", 0, "write the progress reports as CSV rows to FILE (every --report seconds, default 10)"},
+  {"prop_exputil", 'x', "DEPTH", 0, "prune OR domains in propagation with the bound at this depth (default: -1=off)"},
   {"datafile", 'd', "FILE", 0,
     "Read the data from FILE"},
   {"acfile",   'a', "FILE", 0,
@@ -52,6 +78,29 @@ struct arguments
   int branch_or;
   int branch_and;
   int capacity;
+  int dense_mb;
+  int prefetch;
+  int bound_cache;
+  int bound_threads;
+  int adaptive;
+  char* telemetry;
+  int lp_bound;
+  int threads;
+  int c_d;
+  int a_d;
+  int search;
+  int context;
+  char* policy;
+  double timeout;
+  int node_limit;
+  double report;
+  int nogoods;
+  char* portfolio;
+  char* checkpoint;
+  double checkpoint_every;
+  int resume;
+  char* progress;
+  int prop_exputil;
   char *ac_file;
   char *lm_file;
   char* names_file;
@@ -86,6 +135,77 @@ parse_opt (int key, char *arg, struct argp_state *state)
     case 't':
       arguments->capacity = atoi(arg);
       break;
+    case 'm':
+      arguments->dense_mb = atoi(arg);
+      if (arguments->dense_mb < 0)
+        argp_error(state, "dense_mb must be >= 0");
+      break;
+    case 'f':
+      arguments->prefetch = atoi(arg);
+      break;
+    case 'k':
+      arguments->bound_cache = atoi(arg);
+      break;
+    case 'j':
+      arguments->bound_threads = atoi(arg);
+      break;
+    case 'A':
+      arguments->adaptive = atoi(arg);
+      break;
+    case 'T':
+      arguments->telemetry = arg;
+      break;
+    case 'L':
+      arguments->lp_bound = atoi(arg);
+      break;
+    case 'J':
+      arguments->threads = atoi(arg);
+      break;
+    case 'C':
+      arguments->c_d = atoi(arg);
+      break;
+    case 'D':
+      arguments->a_d = atoi(arg);
+      break;
+    case 'S':
+      arguments->search = atoi(arg);
+      break;
+    case 'G':
+      arguments->context = atoi(arg);
+      break;
+    case 'P':
+      arguments->policy = arg;
+      break;
+    case 'u':
+      arguments->timeout = atof(arg);
+      break;
+    case 'N':
+      arguments->node_limit = atoi(arg);
+      break;
+    case 'R':
+      arguments->report = atof(arg);
+      break;
+    case 'g':
+      arguments->nogoods = atoi(arg);
+      break;
+    case 'F':
+      arguments->portfolio = arg;
+      break;
+    case 'K':
+      arguments->checkpoint = arg;
+      break;
+    case 'E':
+      arguments->checkpoint_every = atof(arg);
+      break;
+    case 'Z':
+      arguments->resume = atoi(arg);
+      break;
+    case 'Q':
+      arguments->progress = arg;
+      break;
+    case 'x':
+      arguments->prop_exputil = atoi(arg);
+      break;
     case 'a':
       arguments->ac_file = arg;
       break;
@@ -117,6 +237,29 @@ void getCmOptions(int argc, char** argv) {
   _arguments.branch_or = 0;
   _arguments.branch_and = 0;
   _arguments.capacity = -1;
+  _arguments.dense_mb = 64;
+  _arguments.prefetch = 0;
+  _arguments.bound_cache = 0;
+  _arguments.bound_threads = 1;
+  _arguments.adaptive = 0;
+  _arguments.telemetry = NULL;
+  _arguments.lp_bound = 0;
+  _arguments.threads = 1;
+  _arguments.c_d = 8;
+  _arguments.a_d = 2;
+  _arguments.search = 0;
+  _arguments.context = 0;
+  _arguments.policy = NULL;
+  _arguments.timeout = -1;
+  _arguments.node_limit = 0;
+  _arguments.report = 0;
+  _arguments.nogoods = 0;
+  _arguments.portfolio = NULL;
+  _arguments.checkpoint = NULL;
+  _arguments.checkpoint_every = 600;
+  _arguments.resume = 0;
+  _arguments.progress = NULL;
+  _arguments.prop_exputil = -1;
   _arguments.ac_file = NULL;
   _arguments.lm_file = NULL;
   _arguments.names_file = NULL;
@@ -135,6 +278,29 @@ void getCmOptions(int argc, char** argv) {
   PROG_OPT.branch_or = _arguments.branch_or;
   PROG_OPT.branch_and = _arguments.branch_and;
   PROG_OPT.capacity = _arguments.capacity;
+  PROG_OPT.dense_mb = _arguments.dense_mb;
+  PROG_OPT.prefetch = _arguments.prefetch;
+  PROG_OPT.bound_cache = _arguments.bound_cache;
+  PROG_OPT.bound_threads = _arguments.bound_threads;
+  PROG_OPT.adaptive = _arguments.adaptive;
+  PROG_OPT.telemetry = _arguments.telemetry;
+  PROG_OPT.lp_bound = _arguments.lp_bound;
+  PROG_OPT.threads = _arguments.threads;
+  PROG_OPT.c_d = _arguments.c_d;
+  PROG_OPT.a_d = _arguments.a_d;
+  PROG_OPT.search = _arguments.search;
+  PROG_OPT.context = _arguments.context;
+  PROG_OPT.policy = _arguments.policy;
+  PROG_OPT.timeout = _arguments.timeout;
+  PROG_OPT.node_limit = _arguments.node_limit;
+  PROG_OPT.report = _arguments.report;
+  PROG_OPT.nogoods = _arguments.nogoods;
+  PROG_OPT.portfolio = _arguments.portfolio;
+  PROG_OPT.checkpoint = _arguments.checkpoint;
+  PROG_OPT.checkpoint_every = _arguments.checkpoint_every;
+  PROG_OPT.resume = _arguments.resume;
+  PROG_OPT.progress = _arguments.progress;
+  PROG_OPT.prop_exputil = _arguments.prop_exputil;
   PROG_OPT.ac_file = _arguments.ac_file;
   PROG_OPT.lm_file = _arguments.lm_file;
   PROG_OPT.names_file = _arguments.names_file;
@@ -145,3 +311,55 @@ void getCmOptions(int argc, char** argv) {
      
      
      
+
+// set the PolTreeState options from the command line (the library itself
+// does not know about Cm_opt)
+void configure_poltree(PolTreeState& poltree, const Cm_opt& opts)
+{
+  poltree.bound_cache_mb = std::max(opts.bound_cache, 0);
+  poltree.bound_threads = std::max(opts.bound_threads, 1);
+  poltree.lp_bound = opts.lp_bound;
+  poltree.or_order_depth = (opts.branch_or >= 2 ? opts.branch_or - 2 : -1);
+  poltree.context_on = (opts.context != 0);
+  if (poltree.context_on) {
+    // the BN context of each node follows from the network (see PolTreeState::_context_bn_init)
+    string net_file = net_file_of(opts.lm_file != NULL ? opts.lm_file : "");
+    if (!read_net_parents(net_file, poltree.bn.get_var_ids(), poltree.bn_parents)) {
+      poltree.bn_parents.clear();
+      cerr << "no network structure in " << net_file << ", the context of the BN is all evidence" << endl;
+    }
+  }
+  poltree.nogoods_on = (opts.nogoods != 0);
+  poltree.prop_depth = opts.prop_exputil;
+  poltree.root_bounds = (opts.timeout > 0 || opts.node_limit > 0 || opts.report > 0 || opts.progress != NULL);
+  if (opts.adaptive && poltree.adaptive == NULL)
+    poltree.adaptive = new AdaptiveDepth(opts.depth_or, opts.depth_and, poltree.verbose);
+  if (opts.telemetry != NULL && poltree.telemetry == NULL)
+    poltree.telemetry = new BoundTelemetry(opts.telemetry);
+  // checked before the file is opened, which truncates it
+  bool policy_on = (opts.policy != NULL);
+  if (policy_on && opts.resume) {
+    // the regions of the policy so far are not in the checkpoint
+    cerr << "the policy is not written when resuming\n";
+    policy_on = false;
+  }
+  if (policy_on && (opts.threads > 1 || opts.portfolio != NULL)) {
+    // the writer follows the commits of a single search
+    cerr << "the policy is only written with --threads 1 and no --portfolio\n";
+    policy_on = false;
+  }
+  if (policy_on && poltree.policy == NULL) {
+    poltree.policy = new PolicyWriter(opts.policy);
+    if (!poltree.policy->ok()) {
+      cerr << "cannot open policy file " << opts.policy << "\n";
+      delete poltree.policy;
+      poltree.policy = NULL;
+    }
+  }
+  if (poltree.policy != NULL && poltree.context_on) {
+    // a subtree resolved from the cache has no policy
+    cerr << "context caching is disabled when writing the policy\n";
+    poltree.context_on = false;
+  }
+}
+
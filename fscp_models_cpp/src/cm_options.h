@@ -3,10 +3,13 @@
 
 #pragma GCC diagnostic ignored "-Wunused-function"
 #include <string>
+#include <cstddef>
 using std::string;
 
 extern struct Cm_opt PROG_OPT;
 
+// the file names are NULL unless given, also in a Cm_opt that did not come
+// from getCmOptions() (a path from an uninitialised pointer would be opened)
 struct Cm_opt{
   int verbose;
   int depth_or;
@@ -14,12 +17,38 @@ struct Cm_opt{
   int branch_or;
   int branch_and;
   int capacity;
-  char* ac_file;
-  char* lm_file;
-  char* names_file;
-  char* data_file;
+  int dense_mb;
+  int prefetch;
+  int bound_cache;
+  int bound_threads;
+  int adaptive;
+  char* telemetry = NULL;
+  int lp_bound;
+  int threads;
+  int c_d;
+  int a_d;
+  int search;
+  int context;
+  char* policy = NULL;
+  double timeout;
+  int node_limit;
+  double report;
+  int nogoods;
+  char* portfolio = NULL;
+  char* checkpoint = NULL;
+  double checkpoint_every;
+  int resume;
+  char* progress = NULL;
+  int prop_exputil;
+  char* ac_file = NULL;
+  char* lm_file = NULL;
+  char* names_file = NULL;
+  char* data_file = NULL;
 };
 
 void getCmOptions(int, char**);
 
+class PolTreeState;
+void configure_poltree(PolTreeState&, const Cm_opt&);
+
 #endif //CM_OPTIONS_H
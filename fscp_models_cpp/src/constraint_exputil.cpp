@@ -0,0 +1 @@
+../../fscp_src/constraint_exputil.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/constraint_exputil.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/constraint_prodsum.cpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/constraint_prodsum.hpp
\ No newline at end of file
@@ -0,0 +1 @@
+../../fscp_src/constraint_ranges.cpp
\ No newline at end of file
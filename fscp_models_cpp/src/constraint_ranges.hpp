@@ -0,0 +1 @@
+../../fscp_src/constraint_ranges.hpp
\ No newline at end of file
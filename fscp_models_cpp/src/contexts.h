@@ -0,0 +1,70 @@
+#ifndef CONTEXTS_H
+#define CONTEXTS_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+// Contexts of the subproblems of each model, for context caching
+// (PolTreeState::context_f, option --context). At the first variable of a
+// stage, all earlier stages are assigned; the rest of the problem then only
+// depends on the state below (and on the evidence in PolTreeState::context_bn),
+// and the utility is the utility of the earlier stages (past) plus the rest.
+
+// state: used capacity \sum_{j<i} w_j * x_j
+struct KnapsackContext {
+  size_t numStages;
+  KnapsackContext(size_t numStages0) : numStages(numStages0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, int pos, std::vector<int>& ctx, int& past) const {
+    if (pos%3 != 0)
+      return false;
+    int used = 0;
+    past = 0;
+    for (int j=0; j!=pos/3; j++) {
+      used += VS[3*j+1].first * VS[3*j].first;
+      past += VS[3*j+2].first * VS[3*j].first;
+    }
+    ctx.push_back(used);
+    return true;
+  }
+};
+
+// state: slack \sum_{j<i} (a_j * x_j - b_j * y_j) of constraint 3
+struct Inv2Context {
+  size_t numStages;
+  Inv2Context(size_t numStages0) : numStages(numStages0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, int pos, std::vector<int>& ctx, int& past) const {
+    if (pos%4 != 0)
+      return false;
+    int slack = 0;
+    past = 0;
+    for (int j=0; j!=pos/4; j++) {
+      int ax = VS[4*j+2].first * VS[4*j].first;
+      int by = VS[4*j+3].first * VS[4*j+1].first;
+      slack += ax - by;
+      past += ax + by;
+    }
+    ctx.push_back(slack);
+    return true;
+  }
+};
+
+// state: overstock \sum_{j<i} (d_j - p_j)
+struct BookContext {
+  size_t numStages;
+  BookContext(size_t numStages0) : numStages(numStages0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, int pos, std::vector<int>& ctx, int& past) const {
+    if (pos%2 != 0)
+      return false;
+    int stock = 0;
+    past = 0;
+    for (int j=0; j!=pos/2; j++) {
+      stock += VS[2*j].first - VS[2*j+1].first;
+      past += (numStages-j)*(VS[2*j+1].first - VS[2*j].first);
+    }
+    ctx.push_back(stock);
+    return true;
+  }
+};
+
+#endif //CONTEXTS_H
@@ -0,0 +1 @@
+../../fscp_src/dense_simplex.hpp
\ No newline at end of file
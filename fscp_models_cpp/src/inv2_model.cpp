@@ -9,6 +9,9 @@
 
 #include "inv2_model.h"
 #include "constraint_andall.hpp"
+#include "constraint_exputil.hpp"
+#include "constraint_ranges.hpp"
+#include "constraint_prodsum.hpp"
 #include "brancher_exputil.hpp"
 
 using std::vector;
@@ -68,24 +71,19 @@ Inv2Model::Inv2Model(PolTreeState& poltree, Cm_opt& opts) :
     // util = \sum_i (a_i * x_i + b_i * y_i)
     // \sum_i v[4i+2]*v[4i] + v[4i+3]*v[4i+1]
 
-    IntVarArgs rxs;
+    IntArgs ones;
+    IntVarArgs decs, rands;
     for (size_t i=0; i != numStages; i++) 
       for(size_t j=0; j!=2; j++) {
-        IntVar rx (*this, 0, vars[(4*i)+2+j].max());
-        mult(*this, vars[(4*i)+2+j], vars[4*i+j], rx);
-        rxs << rx;
+        ones << 1;
+        decs << vars[4*i+j];
+        rands << vars[(4*i)+2+j];
     }
-    linear(*this, rxs, IRT_EQ, util);
+    prod_sum(*this, ones, decs, rands, IRT_EQ, util);
 
     // for exputil
-    // now manually and store it in BN (C++11 lambda function, yeuy!)
-    poltree.max_f = [numStages](vector< pair< int, int> >& VS) {
-        int bound = 0;
-        for (size_t i=0; i!=numStages; i++)
-            bound += VS[4*i+2].second * VS[4*i].second + 
-		     VS[4*i+3].second * VS[4*i+1].second;
-        return bound;
-    };
+    // now manually and store it in BN (functor, see utility_functors.h)
+    poltree.set_util(Inv2Util(numStages));
     
     
     // constraint 2:
@@ -105,25 +103,30 @@ Inv2Model::Inv2Model(PolTreeState& poltree, Cm_opt& opts) :
   
     // constraint 3
     // \sum_i b_i * y_i <= sum_i a_i * x_i for all k
+    // as \sum_i a_i * x_i - b_i * y_i >= 0
     
-    IntVarArgs axs, bys;
+    IntArgs signs;
+    IntVarArgs xys, ab;
     for (size_t i=0; i != numStages; i++) 
     {
-        IntVar ax (*this, 0, as[i].max());
-        mult(*this, xs[i], as[i], ax);
-        axs << ax;
-	
-        IntVar by (*this, 0, bs[i].max());
-        mult(*this, ys[i], bs[i], by);
-        bys << by;
+        signs << 1 << -1;
+        xys << xs[i] << ys[i];
+        ab << as[i] << bs[i];
     }
-    IntVar ax_sum(*this, Int::Limits::min, Int::Limits::max);  
-    linear(*this, axs, IRT_EQ, ax_sum);
-    IntVar by_sum(*this, Int::Limits::min, Int::Limits::max);
-    linear(*this, bys, IRT_EQ, by_sum);
-    rel(*this, by_sum, IRT_LQ, ax_sum);
+    prod_sum(*this, signs, xys, ab, IRT_GQ, 0);
+    
+    // for the LP bound, relaxation of constraints 1 to 3 (see lp_relaxations.h)
+    poltree.lp_f = Inv2LP(numStages);
+    // and for context caching (see contexts.h)
+    poltree.context_f = Inv2Context(numStages);
     
    
+    // ranges of the vars for the bounds, kept up to date in the space
+    VarRanges ranges = var_ranges(*this, vars);
+
+    // prune decisions on their bound in propagation (--prop_exputil)
+    exputil_prune(*this, vars, ranges, poltree);
+
     //* branching(Space, vars, poltree, order_or_max, order_and_max, depth_or, depth_and);
     bool order_or_max = true; // default
     if (opts.branch_or == -1)
@@ -131,6 +134,6 @@ Inv2Model::Inv2Model(PolTreeState& poltree, Cm_opt& opts) :
     bool order_and_max = true; // default
     if (opts.branch_and == -1)
         order_and_max = false;
-    branch_exputil(*this, vars, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
+    branch_exputil(*this, vars, ranges, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
 }
 
@@ -11,6 +11,9 @@
 
 #include "cm_options.h"
 #include "policy_tree_state.h"
+#include "utility_functors.h"
+#include "lp_relaxations.h"
+#include "contexts.h"
 
 using std::vector;
 using std::ostream;
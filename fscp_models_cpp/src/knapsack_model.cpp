@@ -9,6 +9,9 @@
 
 #include "knapsack_model.h"
 #include "constraint_andall.hpp"
+#include "constraint_exputil.hpp"
+#include "constraint_ranges.hpp"
+#include "constraint_prodsum.hpp"
 #include "brancher_exputil.hpp"
 
 using std::vector;
@@ -62,38 +65,40 @@ KnapsackModel::KnapsackModel(PolTreeState& poltree, Cm_opt& opts) :
     // and nodes may not have there domain pruned (it will select out the ANDs)
     and_nodes_all(*this, vars, poltree);
 
+    IntArgs ones;
+    IntVarArgs xs, ws, rs;
+    for (size_t i=0; i != numStages; i++) {
+        ones << 1;
+        xs << vars[3*i];
+        ws << vars[3*i+1];
+        rs << vars[3*i+2];
+    }
+
     // constraint 1:
     // util = r_1 * x_1 + ... + r_n * x_n
     // \sum_i v[3i+2]*v[3i]
-
-    IntVarArgs rxs;
-    for (size_t i=0; i != numStages; i++) {
-        IntVar rx (*this, 0, vars[(3*i)+2].max());
-        mult(*this, vars[(3*i)+2], vars[3*i], rx);
-        rxs << rx;
-    }
-    linear(*this, rxs, IRT_EQ, util);
+    prod_sum(*this, ones, xs, rs, IRT_EQ, util);
 
     // for exputil
-    // now manually and store it in BN (C++11 lambda function, yeuy!)
-    poltree.max_f = [numStages](vector< pair< int, int> >& VS) {
-        int bound = 0;
-        for (size_t i=0; i!=numStages; i++)
-            bound += VS[3*i+2].second * VS[3*i].second;
-        return bound;
-    };
+    // now manually and store it in BN (functor, see utility_functors.h)
+    poltree.set_util(KnapsackUtil(numStages));
 
     // constraint 2:
     // sum of weights must be smaller than capacity
     // \sum_i v[3i+1]*v[3i] <= capacity
-    IntVarArgs wxs;
-    for (size_t i=0; i!=numStages; i++) {
-        IntVar wx(*this, 0, vars[3*i+1].max());
-        mult(*this, vars[3*i+1], vars[3*i], wx);
-        wxs << wx;
-    }
     //cout << "capacity:" << opts.capacity << endl;
-    linear(*this, wxs, IRT_LQ, opts.capacity);
+    prod_sum(*this, ones, xs, ws, IRT_LQ, opts.capacity);
+    
+    // for the LP bound, relaxation of constraints 1 and 2 (see lp_relaxations.h)
+    poltree.lp_f = KnapsackLP(numStages, opts.capacity);
+    // and for context caching (see contexts.h)
+    poltree.context_f = KnapsackContext(numStages);
+
+    // ranges of the vars for the bounds, kept up to date in the space
+    VarRanges ranges = var_ranges(*this, vars);
+
+    // prune decisions on their bound in propagation (--prop_exputil)
+    exputil_prune(*this, vars, ranges, poltree);
 
     //* branching(Space, vars, poltree, order_or_max, order_and_max, depth_or, depth_and);
     bool order_or_max = true; // default
@@ -102,6 +107,6 @@ KnapsackModel::KnapsackModel(PolTreeState& poltree, Cm_opt& opts) :
     bool order_and_max = true; // default
     if (opts.branch_and == -1)
         order_and_max = false;
-    branch_exputil(*this, vars, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
+    branch_exputil(*this, vars, ranges, poltree, order_or_max, order_and_max, opts.depth_or, opts.depth_and);
 }
 
@@ -0,0 +1,92 @@
+#ifndef LP_RELAXATIONS_H
+#define LP_RELAXATIONS_H
+
+#include <vector>
+#include <utility>
+#include <cstddef>
+
+#include "dense_simplex.hpp"
+
+// Linear relaxations of each model over the <min,max> ranges of the
+// variables, for the LP bound (PolTreeState::lp_f, option --lp_bound).
+// Every scenario of every policy below the node must be a feasible point
+// of the LP with at least its utility as objective, so a random variable
+// multiplied with a decision gets its most optimistic value (max in the
+// utility, min in a <= constraint on a non-negative decision).
+// They return false if the ranges do not allow it (e.g. negative decisions).
+
+// max \sum_i r_i.max * x_i  s.t.  \sum_i w_i.min * x_i <= capacity
+struct KnapsackLP {
+  size_t numStages;
+  int capacity;
+  KnapsackLP(size_t numStages0, int capacity0) : numStages(numStages0), capacity(capacity0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, DenseLP& lp) const {
+    lp.reset(numStages);
+    int row = lp.add_row(capacity);
+    for (size_t i=0; i!=numStages; i++) {
+      if (VS[3*i].first < 0)
+        return false;
+      lp.set_bounds(i, VS[3*i].first, VS[3*i].second);
+      lp.set_obj(i, VS[3*i+2].second);
+      lp.coef(row, i) = VS[3*i+1].first;
+    }
+    return true;
+  }
+};
+
+// max \sum_i (a_i.max * x_i + b_i.max * y_i)
+// s.t. x_i + y_i <= 1 (x_i != y_i on 0/1 vars)
+//      \sum_i b_i.min * y_i - \sum_i a_i.max * x_i <= 0
+struct Inv2LP {
+  size_t numStages;
+  Inv2LP(size_t numStages0) : numStages(numStages0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, DenseLP& lp) const {
+    lp.reset(2*numStages);
+    int row = lp.add_row(0);
+    for (size_t i=0; i!=numStages; i++) {
+      const std::pair<int,int>& x = VS[4*i];
+      const std::pair<int,int>& y = VS[4*i+1];
+      if (x.first < 0 || y.first < 0)
+        return false;
+      lp.set_bounds(2*i, x.first, x.second);
+      lp.set_bounds(2*i+1, y.first, y.second);
+      lp.set_obj(2*i, VS[4*i+2].second);
+      lp.set_obj(2*i+1, VS[4*i+3].second);
+      lp.coef(row, 2*i) = -VS[4*i+2].second;
+      lp.coef(row, 2*i+1) = VS[4*i+3].first;
+      if (x.second <= 1 && y.second <= 1) {
+        int xor_row = lp.add_row(1);
+        lp.coef(xor_row, 2*i) = 1;
+        lp.coef(xor_row, 2*i+1) = 1;
+      }
+    }
+    return true;
+  }
+};
+
+// max \sum_i (n-i)(p_i - d_i)
+// s.t. \sum_{i<=s} (p_i - d_i) <= 0 for each stage s
+// (linear, so all vars are LP vars over their ranges)
+struct BookLP {
+  size_t numStages;
+  BookLP(size_t numStages0) : numStages(numStages0) {}
+  bool operator()(const std::vector< std::pair<int,int> >& VS, DenseLP& lp) const {
+    lp.reset(2*numStages);
+    for (size_t i=0; i!=numStages; i++) {
+      lp.set_bounds(2*i, VS[2*i].first, VS[2*i].second);
+      lp.set_bounds(2*i+1, VS[2*i+1].first, VS[2*i+1].second);
+      lp.set_obj(2*i, -(int)(numStages-i));
+      lp.set_obj(2*i+1, numStages-i);
+    }
+    for (size_t s=0; s!=numStages; s++) {
+      int row = lp.add_row(0);
+      for (size_t i=0; i<=s; i++) {
+        lp.coef(row, 2*i) = -1;
+        lp.coef(row, 2*i+1) = 1;
+      }
+    }
+    return true;
+  }
+};
+
+#endif //LP_RELAXATIONS_H
@@ -0,0 +1,10 @@
+#ifndef MALLOC_COUNT_H
+#define MALLOC_COUNT_H
+
+#include <cstddef>
+
+// number of calls to operator new so far, only available when linked with
+// profile/malloc_count.cpp (see 'make malloc_count')
+size_t malloc_count();
+
+#endif //MALLOC_COUNT_H
@@ -0,0 +1,293 @@
+#ifndef PARALLEL_SOLVE_H
+#define PARALLEL_SOLVE_H
+
+#include <vector>
+#include <mutex>
+#include <iostream>
+#include <algorithm>
+
+#include <gecode/int.hh>
+#include <gecode/search.hh>
+#include <ace_engine.hpp>
+
+#include "cm_options.h"
+#include "policy_tree_state.h"
+#include "bound_pool.hpp"
+#include "andor_dfs.h"
+
+using std::vector;
+
+// Parallel search over the top of the AND/OR tree (option --threads).
+//
+// Gecode's parallel engines (Search::Options::threads) can not be used: the
+// brancher and PolTreeState::new_leaf() depend on seeing the commits and
+// leaves of one DFS in order (failed AND children are detected through
+// brch_rand_val, values are backed up leaf by leaf), while the parallel
+// engines steal work at arbitrary nodes and need recomputation.
+//
+// Instead, the assignments of the first k positions are enumerated (OR: the
+// domain, AND: the values with non-zero probability) until there are enough
+// of them. Each is an independent subtree that a worker solves with an
+// ordinary DFS (or AndOrDFS), with its own model, PolTreeState and circuit
+// workspace.
+// The subtree values are merged up the prefix when all are done: max over the
+// values of an OR node, sum over the values of an AND node (infeasible if one
+// of them is). If position 0 is an OR node, the best completed child of the
+// root is the lower bound for the subtrees started after it.
+template<class Model>
+class ParallelSolve {
+ public:
+  ParallelSolve(Model* root0, PolTreeState& poltree0, AceEngine& engine0, const Cm_opt& opts0)
+    : root(root0), poltree(poltree0), engine(engine0), opts(opts0), nr_threads(opts0.threads), k(0),
+      sols(0), best_root(poltree0.min_inf), best_val(0) {}
+  ~ParallelSolve();
+
+  // returns the number of solutions (leaves), the statistics are summed
+  int solve(Gecode::Search::Statistics& stats);
+
+ private:
+  Model* root;
+  PolTreeState& poltree;
+  AceEngine& engine;
+  Cm_opt opts; // for the workers
+  size_t nr_threads;
+
+  int k; // prefix length
+  struct Task {
+    vector<int> vals; // of positions 0..k-1
+    bool feasible;
+    double value;
+  };
+  vector<Task> tasks; // in DFS order of the prefix
+  vector<size_t> root_end; // end of the run of tasks with the same root value
+  vector<size_t> root_todo; // per task: tasks left in its run
+
+  std::mutex mutex; // guards the fields below
+  int sols;
+  Gecode::Search::Statistics total;
+  double best_root; // best completed child of an OR root
+  int best_val;
+
+  vector<AceEngine*> workspaces;
+  vector<PolTreeState*> states;
+  vector<Model*> models;
+
+  void _values(int pos, vector< std::pair<int,int> >& evidence, vector<int>& ret);
+  void _split(int pos, vector<int>& vals, vector< std::pair<int,int> >& evidence);
+  void _run(size_t t, size_t w);
+  bool _merge(int pos, size_t lo, size_t hi, double& value) const;
+};
+
+template<class Model>
+ParallelSolve<Model>::~ParallelSolve()
+{
+  for (size_t w=0; w!=models.size(); w++) {
+    delete models[w];
+    delete states[w];
+    delete workspaces[w];
+  }
+}
+
+// values to branch on at pos, in the order of the brancher
+template<class Model>
+void ParallelSolve<Model>::_values(int pos, vector< std::pair<int,int> >& evidence, vector<int>& ret)
+{
+  ret.clear();
+  int bn_id = poltree.varBNid[pos];
+  if (bn_id == -1 || opts.depth_and < 0) {
+    for (Gecode::IntVarValues i(root->vars[pos]); i(); ++i)
+      ret.push_back(i.val());
+  } else {
+    vector< std::pair<int,double> > partials;
+    engine.var_partials(evidence, bn_id, partials);
+    for (size_t i=0; i!=partials.size(); i++)
+      if (partials[i].second != 0 && root->vars[pos].in(partials[i].first))
+        ret.push_back(partials[i].first);
+  }
+}
+
+template<class Model>
+void ParallelSolve<Model>::_split(int pos, vector<int>& vals, vector< std::pair<int,int> >& evidence)
+{
+  if (pos == k) {
+    tasks.push_back(Task());
+    tasks.back().vals = vals;
+    tasks.back().feasible = false;
+    tasks.back().value = poltree.min_inf;
+    return;
+  }
+  vector<int> dom;
+  _values(pos, evidence, dom);
+  int bn_id = poltree.varBNid[pos];
+  for (size_t i=0; i!=dom.size(); i++) {
+    vals.push_back(dom[i]);
+    if (bn_id != -1)
+      evidence.push_back( std::make_pair(bn_id, dom[i]) );
+    _split(pos+1, vals, evidence);
+    if (bn_id != -1)
+      evidence.pop_back();
+    vals.pop_back();
+  }
+}
+
+// value of the prefix node at pos over tasks[lo,hi), false if infeasible
+template<class Model>
+bool ParallelSolve<Model>::_merge(int pos, size_t lo, size_t hi, double& value) const
+{
+  if (pos == k) {
+    value = tasks[lo].value;
+    return tasks[lo].feasible;
+  }
+  bool is_and = (poltree.varBNid[pos] != -1);
+  bool feasible = is_and;
+  value = (is_and ? 0 : poltree.min_inf);
+  if (lo == hi) // no values
+    return false;
+  for (size_t b=lo; b!=hi; ) {
+    size_t e = b;
+    while (e != hi && tasks[e].vals[pos] == tasks[b].vals[pos])
+      e++;
+    double v;
+    bool f = _merge(pos+1, b, e, v);
+    if (is_and) {
+      if (!f)
+        return false;
+      value += v;
+    } else if (f && (!feasible || v > value)) {
+      feasible = true;
+      value = v;
+    }
+    b = e;
+  }
+  return feasible;
+}
+
+template<class Model>
+void ParallelSolve<Model>::_run(size_t t, size_t w)
+{
+  if (models[w] == NULL) {
+    states[w] = new PolTreeState(*workspaces[w], opts.verbose);
+    configure_poltree(*states[w], opts);
+    models[w] = new Model(*states[w], opts);
+    models[w]->status();
+  }
+  PolTreeState& pt = *states[w];
+  Task& task = tasks[t];
+  bool root_or = (poltree.varBNid[0] == -1);
+
+  Model* s = static_cast<Model*>(models[w]->clone());
+  // as committed by the brancher: ConsAndAll accepts no other AND assignment
+  for (int i=0; i!=k; i++) {
+    pt.brch_commit_pos = i;
+    Gecode::rel(*s, s->vars[i], Gecode::IRT_EQ, task.vals[i]);
+  }
+  pt.brch_commit_pos = -1;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    pt.start_subtree(k, (root_or ? best_root : poltree.min_inf)); // from another child of the root
+  }
+  size_t updates = pt.root_updates;
+  int n = 0;
+
+  Gecode::Search::Statistics st;
+  if (opts.search == 1) {
+    AndOrDFS<Model> d(s, pt, opts.verbose);
+    n = d.solve();
+    st = d.statistics();
+  } else {
+    Gecode::Search::Options o;
+    o.c_d = opts.c_d;
+    o.a_d = opts.a_d;
+    Gecode::DFS<Model> d(s, o);
+    while (Model* current_solution = d.next()) {
+      n++;
+      pt.new_leaf(current_solution->vars, current_solution->util);
+      delete current_solution;
+    }
+    st = d.statistics();
+  }
+  delete s;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  task.feasible = (pt.root_updates != updates);
+  task.value = pt.evals[0];
+  sols += n;
+  total += st;
+  // all subtrees of this child of the root done?
+  size_t end = root_end[t];
+  if (root_or && --root_todo[end-1] == 0) {
+    size_t begin = end;
+    while (begin != 0 && tasks[begin-1].vals[0] == task.vals[0])
+      begin--;
+    double v;
+    if (_merge(1, begin, end, v) && v > best_root) {
+      best_root = v;
+      best_val = task.vals[0];
+      if (poltree.verbose >= 0)
+        std::cout << "*** New root: " << best_val << " exputil: " << best_root << "\n";
+    }
+  }
+}
+
+template<class Model>
+int ParallelSolve<Model>::solve(Gecode::Search::Statistics& stats)
+{
+  if (root->status() == Gecode::SS_FAILED)
+    return 0;
+  // longest prefix needed for enough tasks, but leave the last variable to the search
+  int nr_vars = root->vars.size();
+  vector<int> vals;
+  vector< std::pair<int,int> > evidence;
+  do {
+    k++;
+    tasks.clear();
+    _split(0, vals, evidence);
+  } while (tasks.size() < 4*nr_threads && k < nr_vars-1);
+
+  // runs of tasks with the same root value, for the root lower bound
+  root_end.resize(tasks.size());
+  root_todo.assign(tasks.size(), 0);
+  for (size_t e=tasks.size(); e--; ) {
+    bool last = (e+1 == tasks.size() || tasks[e+1].vals[0] != tasks[e].vals[0]);
+    root_end[e] = (last ? e+1 : root_end[e+1]);
+    root_todo[root_end[e]-1]++;
+  }
+
+  // workers get their own copy of the circuit, created here as that reads the
+  // main engine (the dense tensor, if any, is shared read-only); the rest is
+  // built by the workers themselves
+  opts.verbose = -1; // output would interleave
+  opts.telemetry = NULL;
+  opts.policy = NULL;
+  opts.timeout = -1; // no anytime search in the subtrees
+  opts.node_limit = 0;
+  opts.report = 0;
+  opts.progress = NULL;
+  opts.checkpoint = NULL;
+  opts.resume = 0;
+  opts.bound_threads = 1;
+  opts.threads = 1;
+  for (size_t w=0; w!=nr_threads; w++) {
+    workspaces.push_back(engine.new_workspace());
+    states.push_back(NULL);
+    models.push_back(NULL);
+  }
+  if (poltree.verbose >= 1)
+    std::cout << "Parallel search: " << nr_threads << " threads, " << tasks.size()
+              << " subtrees of the first " << k << " positions\n";
+
+  BoundPool pool(nr_threads);
+  pool.run(tasks.size(), [this](size_t t, size_t w) { _run(t, w); });
+
+  double value;
+  if (_merge(0, 0, tasks.size(), value)) {
+    poltree.evals[0] = value;
+    poltree.root_updates++;
+    if (poltree.varBNid[0] != -1 && poltree.verbose >= 0) // OR roots are printed as they complete
+      std::cout << "*** New root: " << root->vars[0] << " exputil: " << value << "\n";
+  }
+  stats = total;
+  return sols;
+}
+
+#endif //PARALLEL_SOLVE_H
@@ -0,0 +1 @@
+../../fscp_src/policy_writer.hpp
\ No newline at end of file
@@ -0,0 +1,250 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+
+#include <vector>
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+
+#include <gecode/int.hh>
+#include <gecode/search.hh>
+#include <ace_engine.hpp>
+
+#include "cm_options.h"
+#include "policy_tree_state.h"
+#include "bound_pool.hpp"
+#include "andor_dfs.h"
+
+using std::vector;
+
+// Portfolio of search configurations (option --portfolio): the same problem
+// is solved by one thread per configuration, each with its own circuit
+// workspace, PolTreeState and model. The first configuration to finish has
+// the optimal value; the others are cancelled through their stop object.
+//
+// A configuration sets depth_or, depth_and, branch_or and branch_and, the
+// other options are those of the command line. The specification is either
+// a number N, for the first N of the built-in list below (the first being
+// the command line itself), or a list "depth_or,depth_and,branch_or,branch_and;..."
+template<class Model>
+class Portfolio {
+ public:
+  Portfolio(Model* root0, PolTreeState& poltree0, AceEngine& engine0, const Cm_opt& opts0);
+  ~Portfolio();
+
+  // returns the number of solutions (leaves) of the winner, and its statistics
+  int solve(Gecode::Search::Statistics& stats);
+  // -1 if the specification could not be parsed
+  int winner() const { return won; }
+
+ private:
+  Model* root;
+  PolTreeState& poltree;
+  AceEngine& engine;
+  const Cm_opt& opts;
+
+  struct Config {
+    Cm_opt opts;
+    bool done; // finished, else cancelled
+    double time;
+    int sols;
+    Gecode::Search::Statistics stats;
+  };
+  vector<Config> configs;
+  vector<AceEngine*> workspaces;
+  vector<PolTreeState*> states;
+
+  std::atomic<bool> cancelled;
+  std::mutex mutex; // guards won
+  int won;
+
+  // ends a search once another configuration won
+  class CancelStop : public Gecode::Search::Stop {
+   public:
+    CancelStop(const std::atomic<bool>& flag0) : flag(flag0) {}
+    virtual bool stop(const Gecode::Search::Statistics&, const Gecode::Search::Options&) {
+      return flag.load(std::memory_order_relaxed);
+    }
+   private:
+    const std::atomic<bool>& flag;
+  };
+
+  bool _parse(const char* spec);
+  void _run(size_t c);
+};
+
+template<class Model>
+Portfolio<Model>::Portfolio(Model* root0, PolTreeState& poltree0, AceEngine& engine0, const Cm_opt& opts0)
+  : root(root0), poltree(poltree0), engine(engine0), opts(opts0), cancelled(false), won(-1)
+{
+  if (!_parse(opts.portfolio))
+    configs.clear();
+}
+
+template<class Model>
+Portfolio<Model>::~Portfolio()
+{
+  for (size_t c=0; c!=states.size(); c++) {
+    delete states[c];
+    delete workspaces[c];
+  }
+}
+
+template<class Model>
+bool Portfolio<Model>::_parse(const char* spec)
+{
+  // depth_or, depth_and, branch_or, branch_and; the first is the command line
+  static const int builtin[][4] = {
+    { 1, 1, 0, 0 },
+    { 0, 2, 0, 0 },
+    { 2, 2, 2, 0 },
+    { 6, 2, 3, 0 },
+    { 1, 3, 2, 0 },
+    { -1, -1, 0, 0 },
+  };
+  static const int nr_builtin = sizeof(builtin)/sizeof(builtin[0]) + 1;
+
+  Config base;
+  base.opts = opts;
+  base.opts.verbose = -1; // output would interleave
+  base.opts.telemetry = NULL;
+  base.opts.policy = NULL;
+  base.opts.portfolio = NULL;
+  base.opts.threads = 1;
+  base.opts.bound_threads = 1;
+  base.opts.timeout = -1;
+  base.opts.node_limit = 0;
+  base.opts.report = 0;
+  base.opts.progress = NULL;
+  base.opts.checkpoint = NULL;
+  base.opts.resume = 0;
+  base.done = false;
+  base.time = 0;
+  base.sols = 0;
+
+  char* end;
+  long n = strtol(spec, &end, 10);
+  if (*end == '\0') {
+    if (n < 1 || n > nr_builtin)
+      return false;
+    configs.assign(n, base);
+    for (long c=1; c<n; c++) {
+      configs[c].opts.depth_or = builtin[c-1][0];
+      configs[c].opts.depth_and = builtin[c-1][1];
+      configs[c].opts.branch_or = builtin[c-1][2];
+      configs[c].opts.branch_and = builtin[c-1][3];
+    }
+    return true;
+  }
+
+  std::string s(spec);
+  size_t b = 0;
+  while (b <= s.size()) {
+    size_t e = s.find(';', b);
+    if (e == std::string::npos)
+      e = s.size();
+    if (e == b) { // empty, e.g. after a trailing ';'
+      b = e+1;
+      continue;
+    }
+    Config c = base;
+    if (sscanf(s.substr(b, e-b).c_str(), "%d,%d,%d,%d", &c.opts.depth_or, &c.opts.depth_and,
+               &c.opts.branch_or, &c.opts.branch_and) != 4)
+      return false;
+    configs.push_back(c);
+    b = e+1;
+  }
+  return !configs.empty();
+}
+
+template<class Model>
+void Portfolio<Model>::_run(size_t c)
+{
+  Config& conf = configs[c];
+  double start = AdaptiveDepth::now();
+  states[c] = new PolTreeState(*workspaces[c], conf.opts.verbose);
+  PolTreeState& pt = *states[c];
+  configure_poltree(pt, conf.opts);
+  Model* s = new Model(pt, conf.opts);
+  CancelStop stop(cancelled);
+
+  bool stopped;
+  if (conf.opts.search == 1) {
+    AndOrDFS<Model> d(s, pt, conf.opts.verbose, &stop);
+    conf.sols = d.solve();
+    conf.stats = d.statistics();
+    stopped = d.stopped();
+  } else {
+    Gecode::Search::Options o;
+    o.c_d = conf.opts.c_d;
+    o.a_d = conf.opts.a_d;
+    o.stop = &stop;
+    Gecode::DFS<Model> d(s, o);
+    while (Model* current_solution = d.next()) {
+      conf.sols++;
+      pt.new_leaf(current_solution->vars, current_solution->util);
+      delete current_solution;
+    }
+    conf.stats = d.statistics();
+    stopped = d.stopped();
+  }
+  delete s;
+  conf.time = AdaptiveDepth::now() - start;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  if (!stopped && won == -1) {
+    conf.done = true;
+    won = c;
+    cancelled = true;
+  }
+}
+
+template<class Model>
+int Portfolio<Model>::solve(Gecode::Search::Statistics& stats)
+{
+  if (configs.empty()) {
+    std::cerr << "invalid portfolio: " << opts.portfolio << "\n";
+    return 0;
+  }
+  if (root->status() == Gecode::SS_FAILED)
+    return 0;
+  // the circuit is read here, by one thread; the dense tensor of the root
+  // model is shared read-only, not built again per configuration
+  for (size_t c=0; c!=configs.size(); c++) {
+    workspaces.push_back(engine.new_workspace());
+    states.push_back(NULL);
+  }
+
+  BoundPool pool(configs.size());
+  pool.run(configs.size(), [this](size_t c, size_t) { _run(c); });
+
+  for (size_t c=0; c!=configs.size(); c++) {
+    const Config& conf = configs[c];
+    std::cout << "Portfolio config " << c << ":"
+              << " depth_or: " << conf.opts.depth_or
+              << " depth_and: " << conf.opts.depth_and
+              << " branch_or: " << conf.opts.branch_or
+              << " branch_and: " << conf.opts.branch_and
+              << (conf.done ? " finished" : " cancelled")
+              << " time: " << conf.time
+              << " nodes: " << conf.stats.node << "\n";
+  }
+  if (won == -1)
+    return 0;
+  PolTreeState& pt = *states[won];
+  std::cout << "Portfolio winner: config " << won << "\n";
+  if (pt.root_updates != 0) {
+    poltree.evals[0] = pt.evals[0];
+    poltree.root_updates++;
+    if (poltree.verbose >= 0)
+      std::cout << "*** New root: " << root->vars[0] << " exputil: " << pt.evals[0] << "\n";
+  }
+  pt.print_stats(std::cout);
+  stats = configs[won].stats;
+  return configs[won].sols;
+}
+
+#endif //PORTFOLIO_H
@@ -12,6 +12,7 @@
 #include "inv2_model.h"
 #include "cm_options.h"
 #include "policy_tree_state.h"
+#include "solve_fscp.h"
 
 using std::cout;
 using std::cerr;
@@ -50,45 +51,24 @@ int main(int argc, char** argv) {
 	int verbose = PROG_OPT.verbose;
         // init BNEngine(AC,LM,cache_level,verbosity)
         AceEngineCpp engine_c(PROG_OPT.ac_file, PROG_OPT.lm_file, 1, verbose);
+        engine_c.set_dense_budget(PROG_OPT.dense_mb);
         PolTreeState poltree(engine_c, verbose);
+        configure_poltree(poltree, PROG_OPT);
 
         // Create the problem
         Inv2Model* s = new Inv2Model(poltree, PROG_OPT);
+        if (PROG_OPT.prefetch)
+            engine_c.start_prefetch(engine_c.new_workspace());
 	
 	if (PROG_OPT.verbose >= 0) {
 	  cout << "ac file: " << PROG_OPT.ac_file << endl;
 	  cout << "lmap file: " << PROG_OPT.lm_file << endl;
 	  cout << "depth_and: " << PROG_OPT.depth_and << endl;
 	  cout << "depth_or: " << PROG_OPT.depth_or << endl;
+	  cout << "dense: " << engine_c.is_dense() << endl;
 	}
 
-        Search::Options o;
-        o.c_d = 0; // recomputation must ABSOLUTELY be disabled!
-        o.a_d = 0; // recomputation must ABSOLUTELY be disabled!
-
-
-        int sols = 0;
-        double start = get_wall_time();
-
-        DFS<Inv2Model> d(s,o);
-        while (Inv2Model* current_solution = d.next()) {
-            sols++;
-            if (verbose >= 1)
-                current_solution->print(cout);
-            poltree.new_leaf(current_solution->vars, current_solution->util);
-            delete current_solution;
-        }
-
-        Search::Statistics stats = d.statistics();
-        if (true) { // (opt.verbose() >= 0) {
-            cout << "Solver stats:"
-                 << " time: " << get_wall_time() - start
-                 << " sols: " << sols
-                 << " fails: " << stats.fail
-                 << " nodes: " << stats.node
-                 << " props: " << stats.propagate
-                 << endl;
-        }
+        solve_fscp(s, poltree, engine_c, PROG_OPT);
 
         delete s;
 
@@ -0,0 +1,132 @@
+#ifndef SEARCH_MONITOR_H
+#define SEARCH_MONITOR_H
+
+#include <iostream>
+#include <fstream>
+#include <chrono>
+#include <cmath>
+#include <sys/resource.h>
+
+#include <gecode/search.hh>
+
+#include "policy_tree_state.h"
+
+// Anytime search and progress reports (options --timeout, --node_limit,
+// --report, --progress): a stop object for DFS or AndOrDFS that ends the
+// search at the time or node budget, and periodically reports:
+// nodes and failures (and per second since the last report), the size and
+// hit rate of the partials cache (lookups answered by the dense tensor count
+// as hits), the incumbent, the upper bound on the
+// root, the gap and the peak RSS. Printed, and with --progress also
+// written as CSV rows, e.g. for plotting the convergence.
+//
+// The incumbent is the value of the best complete policy so far: of an OR
+// root, evals[0] once a child got to the root (new_leaf() only backs up
+// values of completed AND nodes); of an AND root, only at the end. The upper
+// bound is the maximum of the incumbent and the bounds of the root children
+// that are not done (PolTreeState::root_upper_bound()).
+//
+// stop() is called at every node, the clock is only read every 64 calls.
+class SearchMonitor : public Gecode::Search::Stop {
+ public:
+  SearchMonitor(const PolTreeState& poltree0, double timeout0, unsigned long int node_limit0,
+                double report_every0, const char* progress_file=NULL)
+    : poltree(poltree0), timeout(timeout0), node_limit(node_limit0), report_every(report_every0),
+      start(now()), hit(false), calls(0), last_time(start), last_nodes(0), last_fails(0) {
+    if (progress_file != NULL) {
+      csv.open(progress_file);
+      csv << "time,nodes,nodes_per_sec,fails,fails_per_sec,partials_cached,partials_dense,partials_hit_rate,"
+          << "incumbent,bound,gap,peak_rss_mb\n";
+      if (report_every <= 0)
+        report_every = 10;
+    }
+    next_report = start + report_every;
+  }
+
+  virtual bool stop(const Gecode::Search::Statistics& s, const Gecode::Search::Options&) {
+    if (node_limit > 0 && s.node >= node_limit)
+      hit = true;
+    if ((++calls & 63) == 0) {
+      double t = now();
+      if (report_every > 0 && t >= next_report) {
+        report(std::cout, s, false);
+        next_report = t + report_every;
+      }
+      if (timeout > 0 && t - start >= timeout)
+        hit = true;
+    }
+    return hit;
+  }
+  // the budget was used up (the search may have finished just then)
+  bool reached() const { return hit; }
+
+  // done: the search was not stopped, so the incumbent is optimal
+  void report(std::ostream& os, const Gecode::Search::Statistics& s, bool done) {
+    double t = now();
+    double dt = std::max(t - last_time, 1e-9);
+    double nodes_sec = (s.node - last_nodes) / dt;
+    double fails_sec = (s.fail - last_fails) / dt;
+    last_time = t;
+    last_nodes = s.node;
+    last_fails = s.fail;
+    size_t hits = poltree.bn.partials_hits + poltree.bn.dense_lookups;
+    size_t lookups = hits + poltree.bn.partials_misses;
+    double hit_rate = (lookups != 0 ? (double)hits / lookups : 0);
+    size_t cached = poltree.bn.partials_cached();
+    bool have = (poltree.root_updates != 0 && (done || poltree.varBNid[0] == -1));
+    double inc = poltree.evals[0];
+    double ub = (done ? inc : poltree.root_upper_bound());
+    double gap = std::max(ub - inc, 0.0);
+    struct rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    double rss = ru.ru_maxrss / 1024.0; // kB on Linux
+
+    os << "Progress: time: " << t - start
+       << " nodes: " << s.node << " (" << nodes_sec << "/s)"
+       << " fails: " << s.fail << " (" << fails_sec << "/s)"
+       << " partials: " << cached << " dense: " << poltree.bn.dense_lookups << " hit rate: " << hit_rate;
+    if (have)
+      os << " incumbent: " << inc;
+    else
+      os << " incumbent: none";
+    os << " bound: " << ub;
+    if (have) {
+      os << " gap: " << gap;
+      if (ub != 0)
+        os << " (" << 100*gap/std::fabs(ub) << "%)";
+    }
+    os << " peak RSS: " << rss << " MB" << (done ? " optimal" : "") << "\n";
+
+    if (csv.is_open()) {
+      csv << t - start << "," << s.node << "," << nodes_sec << "," << s.fail << "," << fails_sec << ","
+          << cached << "," << poltree.bn.dense_lookups << "," << hit_rate << ",";
+      if (have)
+        csv << inc;
+      csv << "," << ub << ",";
+      if (have)
+        csv << gap;
+      csv << "," << rss << std::endl; // flushed, the run may be killed
+    }
+  }
+
+ private:
+  const PolTreeState& poltree;
+  double timeout; // seconds, <= 0 for none
+  unsigned long int node_limit; // 0 for none
+  double report_every; // seconds, <= 0 for none
+  double start;
+  double next_report;
+  bool hit;
+  unsigned int calls;
+  // at the last report
+  double last_time;
+  unsigned long int last_nodes;
+  unsigned long int last_fails;
+  std::ofstream csv;
+
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+};
+
+#endif //SEARCH_MONITOR_H
@@ -0,0 +1,112 @@
+#ifndef SOLVE_FSCP_H
+#define SOLVE_FSCP_H
+
+#include <iostream>
+#include <cstdlib>
+#include <algorithm>
+
+#include <gecode/int.hh>
+#include <gecode/search.hh>
+
+#include "cm_options.h"
+#include "policy_tree_state.h"
+#include "parallel_solve.h"
+#include "portfolio.h"
+#include "andor_dfs.h"
+#include "search_monitor.h"
+#ifdef COUNT_MALLOC
+#include "malloc_count.h"
+#endif //COUNT_MALLOC
+
+// defined by each driver
+double get_wall_time();
+
+// Solve the model s with the search the options ask for (--portfolio,
+// --threads, --search/--checkpoint or Gecode's DFS) and print the solver
+// statistics, the anytime report and the statistics of poltree. The same
+// for every driver; Model needs the public vars, util and print() of the
+// models. The caller keeps s. Returns the number of solutions (leaves).
+template<class Model>
+int solve_fscp(Model* s, PolTreeState& poltree, AceEngine& engine, const Cm_opt& opts)
+{
+  using std::cout;
+  using std::cerr;
+  using std::endl;
+  int verbose = opts.verbose;
+
+  Gecode::Search::Options o;
+  o.c_d = opts.c_d; // ConsAndAll accepts replayed AND commits too, see BranchExpUtil::assign()
+  o.a_d = opts.a_d;
+  // anytime search and progress: stop at the time or node budget, report the gap
+  SearchMonitor* monitor = NULL;
+  if (poltree.root_bounds) {
+    monitor = new SearchMonitor(poltree, opts.timeout, opts.node_limit, opts.report, opts.progress);
+    o.stop = monitor;
+  }
+
+  int sols = 0;
+  double start = get_wall_time();
+#ifdef COUNT_MALLOC
+  size_t mallocs = malloc_count();
+#endif //COUNT_MALLOC
+
+  Gecode::Search::Statistics stats;
+  bool stopped = false;
+  if (opts.portfolio != NULL) {
+    if (monitor != NULL)
+      cerr << "--timeout, --node_limit, --report and --progress are ignored with --portfolio" << endl;
+    Portfolio<Model> pf(s, poltree, engine, opts);
+    sols = pf.solve(stats);
+  } else if (opts.threads > 1) {
+    if (monitor != NULL)
+      cerr << "--timeout, --node_limit, --report and --progress need --threads 1, ignored" << endl;
+    ParallelSolve<Model> ps(s, poltree, engine, opts);
+    sols = ps.solve(stats);
+  } else if (opts.search == 1 || opts.checkpoint != NULL) { // checkpoints need the native search
+    AndOrDFS<Model> d(s, poltree, verbose, monitor, opts.checkpoint, opts.checkpoint_every);
+    if (opts.resume && !d.resume()) {
+      cerr << "cannot resume from checkpoint " << (opts.checkpoint ? opts.checkpoint : "(none, see --checkpoint)") << endl;
+      exit(1);
+    }
+    sols = d.solve();
+    stats = d.statistics();
+    stopped = d.stopped();
+  } else {
+    Gecode::DFS<Model> d(s,o);
+    while (Model* current_solution = d.next()) {
+      sols++;
+      if (verbose >= 1)
+        current_solution->print(cout);
+      poltree.new_leaf(current_solution->vars, current_solution->util);
+      delete current_solution;
+    }
+    stats = d.statistics();
+    stopped = d.stopped();
+  }
+
+#ifdef COUNT_MALLOC
+  mallocs = malloc_count() - mallocs;
+#endif //COUNT_MALLOC
+  cout << "Solver stats:"
+       << " time: " << get_wall_time() - start
+       << " sols: " << sols
+       << " fails: " << stats.fail
+       << " nodes: " << stats.node
+       << " props: " << stats.propagate
+       << endl;
+  if (monitor != NULL && opts.threads <= 1 && opts.portfolio == NULL) {
+    if (stopped)
+      cout << "search stopped" << endl;
+    monitor->report(cout, stats, !stopped);
+  }
+  poltree.print_stats(cout);
+#ifdef COUNT_MALLOC
+  cout << "Allocations during search: " << mallocs
+       << " per node: " << (double)mallocs / std::max(stats.node, 1UL) << endl;
+#endif //COUNT_MALLOC
+
+  delete monitor;
+  return sols;
+}
+
+#endif //SOLVE_FSCP_H
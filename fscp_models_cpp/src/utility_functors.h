@@ -0,0 +1,87 @@
+#ifndef UTILITY_FUNCTORS_H
+#define UTILITY_FUNCTORS_H
+
+#include <vector>
+#include <utility>
+#include <cassert>
+#include <cstddef>
+
+// Upper bounds on the utility of each model, given the <min,max> range of
+// every variable. These are given to PolTreeState::set_util() so that the
+// bound kernels get instantiated (and inlined) for each model.
+// delta() gives the change of the bound when only VS[pos] changed from 'old',
+// so the bound DFS can update it in O(1) (see UtilUpdate), and reads_from()
+// the lowest position of VS that delta() reads for pos.
+
+// util = \sum_i r_i * x_i, with vars x,w,r per stage
+struct KnapsackUtil {
+  size_t numStages;
+  KnapsackUtil(size_t numStages0) : numStages(numStages0) {}
+  int operator()(const std::vector< std::pair<int,int> >& VS) const {
+    int bound = 0;
+    for (size_t i=0; i!=numStages; i++)
+      bound += VS[3*i+2].second * VS[3*i].second;
+    return bound;
+  }
+  int delta(const std::vector< std::pair<int,int> >& VS, int pos, const std::pair<int,int>& old) const {
+    int i = pos/3;
+    int x = VS[3*i].second;
+    int r = VS[3*i+2].second;
+    switch (pos%3) {
+      case 0: return r*x - r*old.second;
+      case 2: return r*x - old.second*x;
+      default: return 0; // weight not in utility
+    }
+  }
+  int reads_from(int pos) const { return 3*(pos/3); }
+};
+
+// util = n(d_1 - p_1) + (n-1)(d_2 - p_2) + ... + (d_n - p_n), negated
+struct BookUtil {
+  size_t numStages;
+  BookUtil(size_t numStages0) : numStages(numStages0) {}
+  int operator()(const std::vector< std::pair<int,int> >& VS) const {
+    assert(VS.size() == numStages * 2); // V1,S1,V2,S2
+    // return n V1.max - n S1.min + ... + Vnmax - Sn.min
+    int bound = 0;
+    for (size_t i=0; i != numStages; i++){
+      bound -= (numStages-i)*VS[(i*2)].first;
+      bound += (numStages-i)*VS[(i*2)+1].second;
+    }
+    return bound;
+  }
+  int delta(const std::vector< std::pair<int,int> >& VS, int pos, const std::pair<int,int>& old) const {
+    int coef = numStages - pos/2;
+    if (pos%2 == 0)
+      return -coef*(VS[pos].first - old.first);
+    else
+      return coef*(VS[pos].second - old.second);
+  }
+  int reads_from(int pos) const { return pos; }
+};
+
+// util = \sum_i (a_i * x_i + b_i * y_i), with vars x,y,a,b per stage
+struct Inv2Util {
+  size_t numStages;
+  Inv2Util(size_t numStages0) : numStages(numStages0) {}
+  int operator()(const std::vector< std::pair<int,int> >& VS) const {
+    int bound = 0;
+    for (size_t i=0; i!=numStages; i++)
+      bound += VS[4*i+2].second * VS[4*i].second +
+               VS[4*i+3].second * VS[4*i+1].second;
+    return bound;
+  }
+  int delta(const std::vector< std::pair<int,int> >& VS, int pos, const std::pair<int,int>& old) const {
+    int i = pos/4;
+    int j = pos%2; // x_i with a_i, y_i with b_i
+    int x = VS[4*i+j].second;
+    int a = VS[4*i+2+j].second;
+    if (pos%4 < 2)
+      return x*a - old.second*a;
+    else
+      return x*a - x*old.second;
+  }
+  int reads_from(int pos) const { return 4*(pos/4); }
+};
+
+#endif //UTILITY_FUNCTORS_H
@@ -2,29 +2,111 @@
 
 #include <iostream>
 #include <cassert>
+#include <cstdlib>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "bn_engine.hpp"
 
 using std::cout;
 using std::endl;
 
+// dense tensor: level k holds P(e_1..e_k) for every mixed-radix code of the
+// first k variables of order; so the partials of variable k+1 are the
+// d_{k+1} consecutive entries of level k+1 that start at code*d_{k+1}
+struct DenseTensor {
+  vector<int> order; // BN ids, in evidence order
+  vector<size_t> level; // offset of level k in 'data' (cache-line aligned)
+  double* data; // first cache-line aligned entry of buf
+  
+  DenseTensor(const vector<int>& order0, const vector<size_t>& level0)
+    : order(order0), level(level0), buf(level0.back() + line) {
+    size_t misaligned = reinterpret_cast<uintptr_t>(buf.data()) % (line*sizeof(double));
+    data = buf.data() + (misaligned == 0 ? 0 : line - misaligned/sizeof(double));
+  }
+  DenseTensor(const DenseTensor&) = delete; // data points into buf
+  DenseTensor& operator=(const DenseTensor&) = delete;
+  static const size_t line = 64 / sizeof(double); // entries per cache line
+ private:
+  vector<double> buf;
+};
+
 class AceEngine : public BNEngine {
 public:
+    AceEngine() : partials_hits(0), partials_misses(0), dense_lookups(0), dense_budget(0), pf_workspace(NULL), pf_stop(false), pf_done(0) {}
+    virtual ~AceEngine() { stop_prefetch(); }
+    
+    // a fresh engine on the same circuit, with its own evidence and cache
+    virtual AceEngine* new_workspace() = 0;
+    
     // get domain values of random variables
     virtual const vector<vector<int> >* get_val_ids();
     virtual size_t domain_size(int);
 
     // get value,prob pairs of all values of variable_index given the evidence
     virtual vector< pair<int,double> > var_partials(const vector< pair< int, int > >& evidence, int variable);
+    void var_partials(const vector< pair< int, int > >& evidence, int variable, vector< pair<int,double> >& ret); // no allocation if ret has the capacity
     virtual const vector<double>& _var_partials(const vector< pair< int, int > >& new_evidence, int variable) ; // raw, uncached
     // get probability of evidence
     virtual double pr(const vector< pair< int, int > >& evidence);
     virtual double pr(const vector< pair< int, int > >& evidence, int next_var, int next_val); // more efficient then the above
+    
+    // dense mode: precompute all prefix probabilities of the variables in 'order'
+    // (the order in which evidence is given), if the tensor fits the budget;
+    // the tensor is read-only, workspaces share it (see _share_dense())
+    void set_dense_budget(size_t megabytes) { dense_budget = megabytes << 20; }
+    virtual bool init_dense(const vector<int>& order);
+    bool is_dense() const { return dense != NULL; }
+    
+    // speculative prefetching: a background thread evaluates queued queries on
+    // its own workspace (owned from then on) and inserts them in our cache
+    void start_prefetch(AceEngine* workspace);
+    void stop_prefetch();
+    bool is_prefetching() const { return pf_workspace != NULL; }
+    void prefetch(const vector< pair< int, int > >& evidence, int var, int val, int next_var);
+    
+    // partials cache, lookups of _var_partials() (not counting the prefetch thread)
+    size_t partials_hits;
+    size_t partials_misses;
+    size_t partials_cached();
+    size_t dense_lookups; // answered by the dense tensor instead (no cache lookup)
+
+protected:
+    // for new_workspace(): use the tensor of 'other', so that it is built once
+    void _share_dense(const AceEngine& other) { dense = other.dense; dense_budget = other.dense_budget; }
+    
+    // query the circuit, bypassing the cache
+    void _query(const vector< pair< int, int > >& evidence, int variable, vector<double>& lookup);
+    
+    // scratch space, overwritten by each call (avoids allocating it each time)
+    vector< pair<int,int> > pr_evidence;
+    vector<int> q_commit_vars, q_commit_vals, q_retract_vars;
 
 private:
     virtual void query(vector<int>&, vector<int>&, 
 		       vector<int>&, int, 
 		       vector<double>&) = 0;  
+    
+    std::shared_ptr<const DenseTensor> dense; // NULL if not in dense mode, shared with the workspaces
+    size_t dense_budget; // in bytes, 0 = never go dense
+    size_t _dense_code(const vector< pair< int, int > >& evidence);
+    void _dense_fill(DenseTensor& t, vector< pair< int, int > >& evidence, size_t code, vector<double>& probs);
+    
+    // prefetch thread, pf_mutex guards the queue and (while prefetching) cache_partials
+    AceEngine* pf_workspace; // NULL if not prefetching
+    std::thread pf_thread;
+    std::mutex pf_mutex;
+    std::condition_variable pf_cond;
+    std::deque< pair< vector< pair<int,int> >, int > > pf_queue; // (evidence, variable)
+    static const size_t pf_max_queue = 32; // speculative, so drop the oldest beyond this
+    bool pf_stop;
+    size_t pf_done;
+    void _prefetch_loop();
 };
 
 inline
@@ -51,6 +133,11 @@ double AceEngine::pr(const vector<pair<int, int> >& evidence){
     cout << "\n";
   }
   
+  if (dense != NULL && evidence.size() <= dense->order.size()) {
+    dense_lookups++;
+    return dense->data[dense->level[evidence.size()] + _dense_code(evidence)];
+  }
+  
   if (evidence.size() == 0) {
     // empty, so probably 1 but use cache anyway (can't do pop_back trick)
     const vector<double>& probs = _var_partials(evidence, 0);
@@ -60,13 +147,19 @@ double AceEngine::pr(const vector<pair<int, int> >& evidence){
     return pr;
   }
   
-  vector< pair<int,int> > par_evidence(evidence);
-  par_evidence.pop_back(); // remove parent from par_evidence
-  return pr(par_evidence, evidence.back().first, evidence.back().second); // evidence, par_var, par_val
+  pr_evidence.assign(evidence.begin(), evidence.end()-1); // without parent
+  return pr(pr_evidence, evidence.back().first, evidence.back().second); // evidence, par_var, par_val
 }
 
 inline
 double AceEngine::pr(const vector<pair<int, int> >& evidence, int par_var, int par_val) {
+  size_t k = evidence.size();
+  if (dense != NULL && k < dense->order.size() && dense->order[k] == par_var) {
+    size_t code = _dense_code(evidence) * bn_val_ids[par_var].size() + bn_val_map[par_var][par_val];
+    dense_lookups++;
+    return dense->data[dense->level[k+1] + code];
+  }
+  
   // get all probs of parent and extract the one of this child
   const vector<double>& probs = _var_partials(evidence, par_var);
   return probs[bn_val_map[par_var][par_val]];
@@ -74,6 +167,13 @@ double AceEngine::pr(const vector<pair<int, int> >& evidence, int par_var, int p
 
 inline
 vector<pair<int, double> > AceEngine::var_partials(const vector<pair<int, int> >& evidence, int variable){
+  vector< pair<int,double> > ret;
+  var_partials(evidence, variable, ret);
+  return ret;
+}
+
+inline
+void AceEngine::var_partials(const vector<pair<int, int> >& evidence, int variable, vector< pair<int,double> >& ret){
   if (verbose >= 5) {
     cout << "var_partials for var idx: " << variable << "\n";
     cout << "Evidence:\n";
@@ -82,6 +182,20 @@ vector<pair<int, double> > AceEngine::var_partials(const vector<pair<int, int> >
     cout << "\n";
   }
   
+  size_t k = evidence.size();
+  if (dense != NULL && k < dense->order.size() && dense->order[k] == variable) {
+    // no circuit access, the partials are a contiguous block of level k+1
+    dense_lookups++;
+    const vector<int>& order = this->bn_val_ids[variable];
+    const double* probs = dense->data + dense->level[k+1] + _dense_code(evidence) * order.size();
+    ret.resize(order.size());
+    for (size_t i=0; i!=order.size(); i++) {
+      ret[i].first = order[i];
+      ret[i].second = probs[i];
+    }
+    return;
+  }
+  
   const vector<double>& probs = _var_partials(evidence, variable);
   
   // convert to (value,prob) instead of (id,prob)
@@ -89,56 +203,249 @@ vector<pair<int, double> > AceEngine::var_partials(const vector<pair<int, int> >
   if (order.size() != probs.size())
     cout << "var="<<variable<<" order.size="<<order.size()<<" != "<<probs.size()<<" probs.size()\n";
   assert(order.size() == probs.size());
-  vector< pair<int,double> > ret(probs.size());
+  ret.resize(probs.size());
   for (size_t i=0; i!=order.size(); i++) {
     ret[i].first = order[i];
     ret[i].second = probs[i];
   }
-  return ret;
 }
 
 // find the commit and retract var/vals
 inline
 const vector<double>& AceEngine::_var_partials(const vector< pair< int, int > >& evidence, int variable){
   
+  if (pf_workspace != NULL) {
+    // the prefetch thread may insert concurrently; entries are never moved or changed
+    std::unique_lock<std::mutex> lock(pf_mutex);
+    vector<double>& lookup = cache_partials[evidence];
+    lock.unlock();
+    if (lookup.size() == 0) { // cache miss, create
+      partials_misses++;
+      _query(evidence, variable, lookup);
+    } else
+      partials_hits++;
+    return lookup;
+  }
+  
   vector<double>& lookup = cache_partials[evidence];
-  if (lookup.size() == 0) {
-    // cache miss, create
-    
-    vector<int> commit_vars, commit_vals, retract_vars;
-    // New: no need to retract+commit same var: commit overwites previous commit
-    // (and remember: evidence is always in exactly the same order: varBNorder)
-    
-    // overwrite new values of already committed vars
-    size_t sizeboth = std::min(evidence.size(), ac_evidence.size());
-    for (size_t i=0; i!=sizeboth; i++) {
-      if (evidence[i].second != ac_evidence[i].second) {
-        commit_vars.push_back(evidence[i].first);
-        commit_vals.push_back(bn_val_map[evidence[i].first][evidence[i].second]);
-        if (verbose >= 5)
-          cout << "commit var="<<evidence[i].first<<" val_dom="<<evidence[i].second<<" val_idx="<<bn_val_map[evidence[i].first][evidence[i].second]<<"\n";
-      }
-    }
-    // add new values of new vars
-    for (size_t i=sizeboth; i!=evidence.size(); i++) {
+  if (lookup.size() == 0) { // cache miss, create
+    partials_misses++;
+    _query(evidence, variable, lookup);
+  } else
+    partials_hits++;
+  
+  return lookup;
+}
+
+// number of entries, the prefetch thread may be inserting
+inline
+size_t AceEngine::partials_cached()
+{
+  if (pf_workspace != NULL) {
+    std::lock_guard<std::mutex> lock(pf_mutex);
+    return cache_partials.size();
+  }
+  return cache_partials.size();
+}
+
+// commit the difference with the evidence currently in the AC, then query
+inline
+void AceEngine::_query(const vector< pair< int, int > >& evidence, int variable, vector<double>& lookup){
+  vector<int>& commit_vars = q_commit_vars;
+  vector<int>& commit_vals = q_commit_vals;
+  vector<int>& retract_vars = q_retract_vars;
+  commit_vars.clear(); commit_vals.clear(); retract_vars.clear();
+  // New: no need to retract+commit same var: commit overwites previous commit
+  // (and remember: evidence is always in exactly the same order: varBNorder)
+  
+  // overwrite new values of already committed vars
+  size_t sizeboth = std::min(evidence.size(), ac_evidence.size());
+  for (size_t i=0; i!=sizeboth; i++) {
+    if (evidence[i].second != ac_evidence[i].second) {
       commit_vars.push_back(evidence[i].first);
       commit_vals.push_back(bn_val_map[evidence[i].first][evidence[i].second]);
       if (verbose >= 5)
         cout << "commit var="<<evidence[i].first<<" val_dom="<<evidence[i].second<<" val_idx="<<bn_val_map[evidence[i].first][evidence[i].second]<<"\n";
     }
-    // retract old vars
-    for (size_t i=sizeboth; i!=ac_evidence.size(); i++) {
-      retract_vars.push_back(ac_evidence[i].first);
-      if (verbose >= 5)
-        cout << "retract var="<<ac_evidence[i].first<<" val_dom="<<ac_evidence[i].second<<"\n";
-    }
-    
-    // store new evidence
-    ac_evidence = evidence;
-    
-    // query inference engine
-    query(commit_vars, commit_vals, retract_vars, variable, lookup);
-  } // end of cache miss, create
+  }
+  // add new values of new vars
+  for (size_t i=sizeboth; i!=evidence.size(); i++) {
+    commit_vars.push_back(evidence[i].first);
+    commit_vals.push_back(bn_val_map[evidence[i].first][evidence[i].second]);
+    if (verbose >= 5)
+      cout << "commit var="<<evidence[i].first<<" val_dom="<<evidence[i].second<<" val_idx="<<bn_val_map[evidence[i].first][evidence[i].second]<<"\n";
+  }
+  // retract old vars
+  for (size_t i=sizeboth; i!=ac_evidence.size(); i++) {
+    retract_vars.push_back(ac_evidence[i].first);
+    if (verbose >= 5)
+      cout << "retract var="<<ac_evidence[i].first<<" val_dom="<<ac_evidence[i].second<<"\n";
+  }
   
-  return lookup;
+  // store new evidence
+  ac_evidence = evidence;
+  
+  // query inference engine
+  query(commit_vars, commit_vals, retract_vars, variable, lookup);
+}
+
+// mixed-radix code of the evidence values, first variable most significant
+inline
+size_t AceEngine::_dense_code(const vector< pair< int, int > >& evidence)
+{
+  size_t code = 0;
+  for (size_t i=0; i!=evidence.size(); i++) {
+    assert(evidence[i].first == dense->order[i]);
+    code = code * bn_val_ids[evidence[i].first].size() + bn_val_map[evidence[i].first][evidence[i].second];
+  }
+  return code;
+}
+
+inline
+bool AceEngine::init_dense(const vector<int>& order)
+{
+  if (dense != NULL && dense->order == order)
+    return true; // shared by the engine this is a workspace of
+  dense.reset();
+  if (dense_budget == 0 || order.empty())
+    return false;
+  
+  // estimate size: level k has prod_{i<k} d_i entries, each level padded to a cache line
+  const size_t line = DenseTensor::line;
+  vector<size_t> level(order.size()+2);
+  size_t entries = 1;
+  level[0] = 0;
+  for (size_t k=0; k<=order.size(); k++) {
+    level[k+1] = level[k] + (entries + line-1) / line * line;
+    if (level[k+1] * sizeof(double) > dense_budget)
+      return false;
+    if (k != order.size())
+      entries *= bn_val_ids[order[k]].size();
+  }
+  
+  size_t bytes = level.back() * sizeof(double);
+  std::unique_ptr<DenseTensor> t;
+  try {
+    t.reset(new DenseTensor(order, level));
+  } catch (const std::bad_alloc&) {
+    return false;
+  }
+  
+  // enumerate the network once, in order, straight from the circuit
+  vector< pair<int,int> > evidence;
+  evidence.reserve(order.size());
+  vector<double> probs;
+  _query(evidence, order[0], probs);
+  double p = 0.0;
+  for (auto& v: probs)
+    p += v;
+  t->data[0] = p;
+  _dense_fill(*t, evidence, 0, probs);
+  dense = std::move(t);
+  
+  if (verbose >= 1)
+    cout << "dense tensor: " << order.size() << " vars, " << bytes << " bytes\n";
+  return true;
+}
+
+// fill level evidence.size()+1 below the prefix with the given code
+inline
+void AceEngine::_dense_fill(DenseTensor& t, vector< pair< int, int > >& evidence, size_t code, vector<double>& probs)
+{
+  size_t k = evidence.size();
+  int var = t.order[k];
+  const vector<int>& vals = bn_val_ids[var];
+  size_t base = code * vals.size();
+  double* out = t.data + t.level[k+1] + base;
+  
+  if (t.data[t.level[k] + code] == 0) {
+    // impossible prefix, no need to ask the circuit
+    for (size_t i=0; i!=vals.size(); i++)
+      out[i] = 0;
+  } else {
+    if (k != 0) // level 0 was queried by the caller
+      _query(evidence, var, probs);
+    assert(probs.size() == vals.size());
+    for (size_t i=0; i!=vals.size(); i++)
+      out[i] = probs[i];
+  }
+  
+  if (k+1 == t.order.size())
+    return;
+  evidence.push_back( std::make_pair(var, -1) ); // value, will be overwritten
+  for (size_t i=0; i!=vals.size(); i++) {
+    evidence.back().second = vals[i];
+    _dense_fill(t, evidence, base + i, probs);
+  }
+  evidence.pop_back();
+}
+
+inline
+void AceEngine::start_prefetch(AceEngine* workspace)
+{
+  if (pf_workspace != NULL || dense != NULL) {
+    // already running, or nothing left to prefetch
+    delete workspace;
+    return;
+  }
+  pf_workspace = workspace;
+  pf_stop = false;
+  pf_thread = std::thread(&AceEngine::_prefetch_loop, this);
+}
+
+inline
+void AceEngine::stop_prefetch()
+{
+  if (pf_workspace == NULL)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(pf_mutex);
+    pf_stop = true;
+  }
+  pf_cond.notify_one();
+  pf_thread.join();
+  if (verbose >= 1)
+    cout << "prefetched: " << pf_done << " partials\n";
+  delete pf_workspace;
+  pf_workspace = NULL;
+  pf_queue.clear();
+}
+
+// queue the partials of next_var given evidence + (var,val)
+inline
+void AceEngine::prefetch(const vector< pair< int, int > >& evidence, int var, int val, int next_var)
+{
+  if (pf_workspace == NULL)
+    return;
+  {
+    std::lock_guard<std::mutex> lock(pf_mutex);
+    if (pf_queue.size() == pf_max_queue)
+      pf_queue.pop_front();
+    pf_queue.push_back( std::make_pair(evidence, next_var) );
+    pf_queue.back().first.push_back( std::make_pair(var, val) );
+  }
+  pf_cond.notify_one();
+}
+
+inline
+void AceEngine::_prefetch_loop()
+{
+  vector<double> probs;
+  std::unique_lock<std::mutex> lock(pf_mutex);
+  while (true) {
+    pf_cond.wait(lock, [this]{ return pf_stop || !pf_queue.empty(); });
+    if (pf_stop)
+      break;
+    pair< vector< pair<int,int> >, int > job;
+    job.swap(pf_queue.front());
+    pf_queue.pop_front();
+    if (cache_partials.count(job.first) != 0)
+      continue; // the search got there first
+    
+    lock.unlock();
+    pf_workspace->_query(job.first, job.second, probs);
+    lock.lock();
+    if (cache_partials.emplace(job.first, probs).second)
+      pf_done++;
+  }
 }
@@ -21,6 +21,8 @@ inline int get_int_name(string name){
 class AceEngineCpp : public AceEngine{
  public:
   AceEngineCpp (string, string, int cache_level=1, int verbosity=0);
+  AceEngineCpp (const AceEngineCpp&); // workspace copy, see new_workspace()
+  virtual AceEngine* new_workspace() { return new AceEngineCpp(*this); }
   // get names:ids of random variables 
   virtual const unordered_map<string,int> get_var_ids();
   virtual int num_vars();
@@ -56,6 +58,19 @@ inline AceEngineCpp::AceEngineCpp(string ac_filename, string lm_filename, int ca
   }
 }
 
+// private copy of the circuit and mappings, without reading the files again;
+// the evidence starts empty and the partials cache is not copied, the dense
+// tensor (read-only) is shared
+inline AceEngineCpp::AceEngineCpp(const AceEngineCpp& other) :
+  engine(other.engine), evidence(engine), variables(other.variables)
+{
+  this->set_verbose(other.verbose);
+  this->set_cache_level(other.cache_level);
+  bn_val_ids = other.bn_val_ids;
+  bn_val_map = other.bn_val_map;
+  _share_dense(other);
+}
+
 inline int AceEngineCpp::num_vars()
 {
   return variables.size();
@@ -77,8 +92,7 @@ inline void AceEngineCpp::query(vector< int >& commit_vars, vector< int >& commi
   for (auto r_var : retract_vars)
     evidence.varRetract(variables[r_var]);
   engine.assertEvidence(evidence, true);
-  Variable var = variables[variable_index];
-  // XXX this should better be (const) Variable& var = ... to avoid copy
+  const Variable& var = variables[variable_index];
   lookup = engine.varPartials(var);
 }
 
@@ -0,0 +1,199 @@
+#ifndef ADAPTIVE_DEPTH_HPP
+#define ADAPTIVE_DEPTH_HPP
+
+#include <vector>
+#include <chrono>
+#include <iostream>
+#include <algorithm>
+
+using std::vector;
+
+// Online choice of the bound depth, per position in the variable order.
+//
+// For every position and depth we keep (decayed) totals of the bound time,
+// the number of bound checks and the number of prunes. The expected cost of
+// a check at depth d is
+//   time/checks + (1 - prunes/checks) * subtree_time
+// where subtree_time is the running average time spent below a non-pruned
+// node at that position. Every 'window' checks the depth moves to a
+// neighbouring depth if that one is cheaper (or has not been tried yet).
+class AdaptiveDepth {
+ public:
+  AdaptiveDepth(int depth_or, int depth_and, int verbose0=0)
+    : verbose(verbose0), init_or(depth_or), init_and(depth_and) {}
+
+  void init(const vector<int>& varBNid);
+  int depth(int pos) const { return levels[pos].depth; }
+  // the search commits a value at pos (closes the subtrees at pos and below)
+  void enter(int pos);
+  // time spent computing bounds at pos with depth d, not yet checked
+  void add_time(int pos, int d, double secs);
+  // a bound check at pos with depth d (including time spent, if any)
+  void bound(int pos, int d, double secs, bool pruned);
+  void print(std::ostream& os) const;
+
+  static double now() {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+  }
+
+ private:
+  static const int window = 32; // checks between two decisions
+  static const int probe_every = 8; // windows, re-measure a neighbour even if worse
+  static const int max_extra = 2; // never deeper than the given depth + max_extra
+  struct DepthStats {
+    double time;
+    double checks;
+    double prunes;
+  };
+  struct Level {
+    int depth; // current
+    int min_depth;
+    int max_depth;
+    vector<DepthStats> stats; // per depth
+    double subtree_time; // running average, < 0 if no sample yet
+    bool open; // non-pruned subtree under way
+    double start;
+    int checks; // at the current depth, since the last decision
+    int windows;
+    int changes;
+  };
+  int verbose;
+  int init_or;
+  int init_and;
+  vector<Level> levels;
+  double cost(const Level& l, int d) const;
+  void decide(int pos);
+};
+
+inline
+void AdaptiveDepth::init(const vector<int>& varBNid)
+{
+  levels.resize(varBNid.size());
+  for (size_t i=0; i!=levels.size(); i++) {
+    Level& l = levels[i];
+    bool is_and = (varBNid[i] != -1);
+    l.depth = (is_and ? init_and : init_or);
+    l.min_depth = (is_and ? 1 : 0); // AND depth 0 is a different kind of bound
+    l.max_depth = std::max(l.depth + max_extra, l.min_depth);
+    l.depth = std::max(l.depth, l.min_depth);
+    DepthStats none = {0, 0, 0};
+    l.stats.assign(l.max_depth+1, none);
+    l.subtree_time = -1;
+    l.open = false;
+    l.start = 0;
+    l.checks = 0;
+    l.windows = 0;
+    l.changes = 0;
+  }
+}
+
+inline
+void AdaptiveDepth::enter(int pos)
+{
+  double t = now();
+  for (size_t i=pos; i!=levels.size(); i++) {
+    Level& l = levels[i];
+    if (l.open) {
+      double sample = t - l.start;
+      if (l.subtree_time < 0)
+        l.subtree_time = sample;
+      else
+        l.subtree_time = 0.9*l.subtree_time + 0.1*sample;
+      l.open = false;
+    }
+  }
+  levels[pos].open = true;
+  levels[pos].start = t;
+}
+
+inline
+void AdaptiveDepth::add_time(int pos, int d, double secs)
+{
+  levels[pos].stats[d].time += secs;
+}
+
+inline
+void AdaptiveDepth::bound(int pos, int d, double secs, bool pruned)
+{
+  Level& l = levels[pos];
+  DepthStats& s = l.stats[d];
+  s.time += secs;
+  s.checks += 1;
+  if (pruned) {
+    s.prunes += 1;
+    l.open = false; // nothing below
+  }
+  if (d == l.depth && ++l.checks == window)
+    decide(pos);
+}
+
+inline
+double AdaptiveDepth::cost(const Level& l, int d) const
+{
+  const DepthStats& s = l.stats[d];
+  double subtree = std::max(l.subtree_time, 0.0);
+  return s.time/s.checks + (1 - s.prunes/s.checks) * subtree;
+}
+
+inline
+void AdaptiveDepth::decide(int pos)
+{
+  Level& l = levels[pos];
+  l.checks = 0;
+  l.windows++;
+  int d = l.depth;
+  double c = cost(l, d);
+
+  int best = d;
+  double best_cost = c;
+  int lo = std::max(d-1, l.min_depth);
+  int hi = std::min(d+1, l.max_depth);
+  for (int n=lo; n<=hi; n++) {
+    if (n == d)
+      continue;
+    if (l.stats[n].checks == 0) { // untried, measure it first
+      best = n;
+      break;
+    }
+    double cn = cost(l, n);
+    if (cn < best_cost) {
+      best = n;
+      best_cost = cn;
+    }
+  }
+  // estimates of the neighbours get stale, re-measure one now and then
+  if (best == d && l.windows % probe_every == 0 && hi != lo)
+    best = ((l.windows / probe_every) % 2 == 0 ? lo : hi);
+
+  // forget old measurements of the depth we leave
+  l.stats[d].time /= 2;
+  l.stats[d].checks /= 2;
+  l.stats[d].prunes /= 2;
+
+  if (best != d) {
+    if (verbose >= 2)
+      std::cout << "Adaptive depth at "<<pos<<": "<<d<<" -> "<<best<<" (cost "<<c<<")\n";
+    l.depth = best;
+    l.changes++;
+  }
+}
+
+inline
+void AdaptiveDepth::print(std::ostream& os) const
+{
+  os << "Adaptive depths:";
+  for (size_t i=0; i!=levels.size(); i++)
+    os << " " << levels[i].depth;
+  os << "\n";
+  if (verbose >= 1) {
+    for (size_t i=0; i!=levels.size(); i++) {
+      const Level& l = levels[i];
+      if (l.windows == 0)
+        continue;
+      os << "  pos " << i << ": depth " << l.depth << " changes " << l.changes
+         << " subtree_time " << l.subtree_time << "\n";
+    }
+  }
+}
+
+#endif //ADAPTIVE_DEPTH_HPP
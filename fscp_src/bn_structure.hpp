@@ -0,0 +1,73 @@
+#ifndef BN_STRUCTURE_HPP
+#define BN_STRUCTURE_HPP
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iterator>
+#include <unordered_map>
+
+using std::string;
+using std::vector;
+using std::unordered_map;
+
+// The parents of each BN variable, read from the 'potential ( child | parents )'
+// lines of the Hugin .net file that the circuit was compiled from. The ids are
+// those of the engine (var_ids, BNEngine::get_var_ids()). False if the file
+// can not be read or names a variable the engine does not know.
+inline
+bool read_net_parents(const string& net_file,
+                      const unordered_map<string,int>& var_ids,
+                      vector< vector<int> >& parents)
+{
+  std::ifstream in(net_file.c_str());
+  if (!in)
+    return false;
+  std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  parents.assign(var_ids.size(), vector<int>());
+  vector<bool> seen(var_ids.size(), false);
+  size_t at = 0;
+  while ((at = text.find("potential", at)) != string::npos) {
+    size_t open = text.find('(', at);
+    size_t close = text.find(')', open);
+    if (open == string::npos || close == string::npos)
+      return false;
+    string decl = text.substr(open+1, close-open-1);
+    at = close;
+    size_t bar = decl.find('|');
+    std::istringstream child_in(decl.substr(0, bar));
+    string child;
+    if (!(child_in >> child) || var_ids.count(child) == 0)
+      return false;
+    int c = var_ids.at(child);
+    seen[c] = true;
+    if (bar == string::npos)
+      continue;
+    std::istringstream parents_in(decl.substr(bar+1));
+    string parent;
+    while (parents_in >> parent) {
+      if (var_ids.count(parent) == 0)
+        return false;
+      parents[c].push_back(var_ids.at(parent));
+    }
+  }
+  // every variable has a potential
+  for (size_t i=0; i!=seen.size(); i++)
+    if (!seen[i])
+      return false;
+  return true;
+}
+
+// the .net file next to the literal map 'name.net.lmap'
+inline
+string net_file_of(const string& lm_file)
+{
+  const string ext = ".lmap";
+  if (lm_file.size() > ext.size() && lm_file.compare(lm_file.size()-ext.size(), ext.size(), ext) == 0)
+    return lm_file.substr(0, lm_file.size()-ext.size());
+  return lm_file;
+}
+
+#endif //BN_STRUCTURE_HPP
@@ -0,0 +1,158 @@
+#ifndef BOUND_CACHE_HPP
+#define BOUND_CACHE_HPP
+
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstddef>
+#include <limits>
+
+using std::vector;
+using std::pair;
+
+// Transposition table of the depth-limited bounds (see PolTreeState::_bound_dfs).
+// A key is a sequence of ints, built with key_begin() and key_add(); the
+// value is looked up with find() and stored with insert() for the key built
+// last.
+//
+// All memory is taken in init(), from a budget in bytes: the keys are packed
+// one after the other into an arena, and the table is open addressing with
+// linear probing, kept at most half full. When either is full everything is
+// dropped (a flush), so the search itself never allocates.
+class BoundCache {
+ public:
+  BoundCache() : flushes(0), arena_end(0), key_hash(0), used(0) {}
+
+  // budget in bytes (0 = disabled), max_key: ints in the longest key
+  void init(size_t bytes, size_t max_key);
+  bool enabled() const { return !slots.empty(); }
+  size_t entries() const { return used; }
+
+  void key_begin(int pos, int depth_limit, int util) {
+    key.clear();
+    key.push_back(pos);
+    key.push_back(depth_limit);
+    key.push_back(util);
+  }
+  // the pairs v[from..]
+  void key_add(const vector< pair<int,int> >& v, size_t from) {
+    key.push_back(v.size() - from); // separates the parts
+    for (size_t i=from; i<v.size(); i++) {
+      key.push_back(v[i].first);
+      key.push_back(v[i].second);
+    }
+  }
+  bool find(double& v);
+  void insert(double v);
+
+  size_t flushes;
+
+ private:
+  struct Slot {
+    uint64_t hash;
+    uint32_t begin; // in the arena
+    uint32_t size; // 0 = empty slot
+    double value;
+  };
+  vector<Slot> slots; // a power of two
+  vector<int> arena;
+  size_t arena_end;
+  vector<int> key; // built last, reserved in init()
+  uint64_t key_hash;
+  size_t used;
+
+  size_t _probe(); // slot of the key, or the empty slot where it goes
+  void _flush();
+};
+
+inline
+void BoundCache::init(size_t bytes, size_t max_key)
+{
+  slots.clear();
+  arena.clear();
+  key.clear();
+  used = 0;
+  arena_end = 0;
+  if (bytes == 0)
+    return;
+  // a quarter for the table, the rest for the keys; at least two slots so
+  // that probing always ends on an empty one
+  size_t n = 2;
+  while (2*n*sizeof(Slot) <= bytes/4)
+    n *= 2;
+  size_t ints = (bytes - n*sizeof(Slot)) / sizeof(int);
+  if (ints > std::numeric_limits<uint32_t>::max())
+    ints = std::numeric_limits<uint32_t>::max();
+  if (ints < max_key)
+    ints = max_key;
+  slots.assign(n, Slot());
+  for (size_t i=0; i!=n; i++)
+    slots[i].size = 0;
+  arena.resize(ints);
+  key.reserve(max_key);
+}
+
+inline
+size_t BoundCache::_probe()
+{
+  // 64 bit FNV-1a
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i=0; i!=key.size(); i++)
+    h = (h ^ (uint32_t)key[i]) * 1099511628211ULL;
+  key_hash = h;
+  size_t mask = slots.size()-1;
+  for (size_t s = h & mask; ; s = (s+1) & mask) {
+    const Slot& slot = slots[s];
+    if (slot.size == 0)
+      return s;
+    if (slot.hash == h && slot.size == key.size()) {
+      const int* k = &arena[slot.begin];
+      size_t i = 0;
+      while (i != key.size() && k[i] == key[i])
+        i++;
+      if (i == key.size())
+        return s;
+    }
+  }
+}
+
+inline
+bool BoundCache::find(double& v)
+{
+  const Slot& slot = slots[_probe()];
+  if (slot.size == 0)
+    return false;
+  v = slot.value;
+  return true;
+}
+
+inline
+void BoundCache::insert(double v)
+{
+  if (2*(used+1) > slots.size() || arena_end + key.size() > arena.size())
+    _flush();
+  Slot& slot = slots[_probe()];
+  if (slot.size != 0) { // already there
+    slot.value = v;
+    return;
+  }
+  slot.hash = key_hash;
+  slot.begin = arena_end;
+  slot.size = key.size();
+  slot.value = v;
+  for (size_t i=0; i!=key.size(); i++)
+    arena[arena_end++] = key[i];
+  used++;
+}
+
+inline
+void BoundCache::_flush()
+{
+  for (size_t i=0; i!=slots.size(); i++)
+    slots[i].size = 0;
+  arena_end = 0;
+  used = 0;
+  flushes++;
+}
+
+#endif //BOUND_CACHE_HPP
@@ -0,0 +1,101 @@
+#ifndef BOUND_POOL_HPP
+#define BOUND_POOL_HPP
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+
+using std::vector;
+
+// Fixed set of worker threads that run batches of independent tasks.
+// run() hands out the tasks 0..n-1 and returns when all of them are done,
+// the function gets (task, worker) so that each worker can use its own state.
+// Worker w first runs task w, the rest go to whichever worker is free; so
+// a batch no larger than the pool runs all at once (as the portfolio needs).
+class BoundPool {
+ public:
+  BoundPool(size_t nr_threads);
+  ~BoundPool();
+
+  size_t size() const { return threads.size(); }
+  void run(size_t nr_tasks, const std::function<void(size_t,size_t)>& fn);
+
+ private:
+  vector<std::thread> threads;
+  std::mutex mutex;
+  std::condition_variable work_cond;
+  std::condition_variable done_cond;
+  const std::function<void(size_t,size_t)>* job; // current batch, NULL if none
+  size_t job_size;
+  size_t job_next; // next task to hand out, after one per worker
+  size_t job_done;
+  size_t generation; // incremented for every batch
+  bool stop;
+  void _loop(size_t worker);
+};
+
+inline
+BoundPool::BoundPool(size_t nr_threads)
+  : job(NULL), job_size(0), job_next(0), job_done(0), generation(0), stop(false)
+{
+  for (size_t i=0; i!=nr_threads; i++)
+    threads.push_back( std::thread(&BoundPool::_loop, this, i) );
+}
+
+inline
+BoundPool::~BoundPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stop = true;
+  }
+  work_cond.notify_all();
+  for (size_t i=0; i!=threads.size(); i++)
+    threads[i].join();
+}
+
+inline
+void BoundPool::run(size_t nr_tasks, const std::function<void(size_t,size_t)>& fn)
+{
+  if (nr_tasks == 0)
+    return;
+  std::unique_lock<std::mutex> lock(mutex);
+  job = &fn;
+  job_size = nr_tasks;
+  job_next = std::min(nr_tasks, threads.size());
+  job_done = 0;
+  generation++;
+  work_cond.notify_all();
+  done_cond.wait(lock, [this]{ return job_done == job_size; });
+  job = NULL;
+}
+
+inline
+void BoundPool::_loop(size_t worker)
+{
+  size_t seen = 0; // last generation worked on
+  std::unique_lock<std::mutex> lock(mutex);
+  while (true) {
+    work_cond.wait(lock, [this,worker,seen]{
+        return stop || (job != NULL && ((generation != seen && worker < job_size) || job_next != job_size)); });
+    if (stop)
+      break;
+    size_t task;
+    if (generation != seen && worker < job_size) { // its own task first
+      task = worker;
+      seen = generation;
+    } else
+      task = job_next++;
+    const std::function<void(size_t,size_t)>* fn = job;
+    lock.unlock();
+    (*fn)(task, worker);
+    lock.lock();
+    if (++job_done == job_size)
+      done_cond.notify_one();
+  }
+}
+
+#endif //BOUND_POOL_HPP
@@ -0,0 +1,148 @@
+#ifndef BOUND_TELEMETRY_HPP
+#define BOUND_TELEMETRY_HPP
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+
+using std::vector;
+using std::string;
+
+// Counters on the bounds computed by the brancher, per position in the
+// variable order, written as CSV at the end of the run.
+//
+// The slack of an OR bound is the bound minus the exact value of the child
+// it was computed for. That value is known once the child's subtree is done,
+// i.e. at the next commit at or above the position, from evals[pos+1] as
+// backed up by new_leaf(). It is only exact if it beats the lower bound the
+// bound was checked against (otherwise the subtree may have been pruned), so
+// the other children are only counted.
+class BoundTelemetry {
+ public:
+  BoundTelemetry(const string& filename0) : filename(filename0) {}
+
+  void init(const vector<int>& varBNid);
+  // bound_or() in commit of an OR node, or of an AND node at depth 0
+  void or_bound(int pos, double secs, bool pruned, double bnd, double lb);
+  // bounds_and() in choice of an AND node
+  void and_bounds(int pos, double secs);
+  // the upperbounds check in commit of an AND node
+  void and_check(int pos, bool pruned);
+  // a commit at pos: the subtrees at pos and below are done
+  void close_from(int pos, const vector<double>& evals);
+  bool write_csv() const;
+
+  const string filename;
+
+ private:
+  struct Level {
+    bool is_and;
+    size_t or_bounds;
+    size_t and_bounds;
+    size_t prunes_bound_or;
+    size_t prunes_upperbounds;
+    double bound_time;
+    size_t slack_samples;
+    double slack_sum;
+    size_t slack_unknown; // child did not beat the lb
+    bool pending; // OR bound waiting for the child's value
+    double pending_bnd;
+    double pending_lb;
+  };
+  vector<Level> levels;
+};
+
+inline
+void BoundTelemetry::init(const vector<int>& varBNid)
+{
+  levels.resize(varBNid.size());
+  for (size_t i=0; i!=levels.size(); i++) {
+    Level& l = levels[i];
+    l.is_and = (varBNid[i] != -1);
+    l.or_bounds = 0;
+    l.and_bounds = 0;
+    l.prunes_bound_or = 0;
+    l.prunes_upperbounds = 0;
+    l.bound_time = 0;
+    l.slack_samples = 0;
+    l.slack_sum = 0;
+    l.slack_unknown = 0;
+    l.pending = false;
+  }
+}
+
+inline
+void BoundTelemetry::or_bound(int pos, double secs, bool pruned, double bnd, double lb)
+{
+  Level& l = levels[pos];
+  l.or_bounds++;
+  l.bound_time += secs;
+  if (pruned) {
+    l.prunes_bound_or++;
+  } else if (!l.is_and && pos+1 != (int)levels.size()) {
+    l.pending = true;
+    l.pending_bnd = bnd;
+    l.pending_lb = lb;
+  }
+}
+
+inline
+void BoundTelemetry::and_bounds(int pos, double secs)
+{
+  levels[pos].and_bounds++;
+  levels[pos].bound_time += secs;
+}
+
+inline
+void BoundTelemetry::and_check(int pos, bool pruned)
+{
+  if (pruned)
+    levels[pos].prunes_upperbounds++;
+}
+
+inline
+void BoundTelemetry::close_from(int pos, const vector<double>& evals)
+{
+  for (size_t i=pos; i!=levels.size(); i++) {
+    Level& l = levels[i];
+    if (!l.pending)
+      continue;
+    l.pending = false;
+    double value = evals[i+1];
+    if (value > l.pending_lb) {
+      l.slack_samples++;
+      l.slack_sum += l.pending_bnd - value;
+    } else {
+      l.slack_unknown++;
+    }
+  }
+}
+
+inline
+bool BoundTelemetry::write_csv() const
+{
+  std::ofstream out(filename.c_str());
+  if (!out) {
+    std::cerr << "error: could not write telemetry to " << filename << std::endl;
+    return false;
+  }
+  out << "pos,type,or_bounds,and_bounds,prunes_bound_or,prunes_upperbounds,bound_time,"
+      << "slack_samples,avg_slack,slack_unknown\n";
+  for (size_t i=0; i!=levels.size(); i++) {
+    const Level& l = levels[i];
+    out << i << "," << (l.is_and ? "AND" : "OR")
+        << "," << l.or_bounds
+        << "," << l.and_bounds
+        << "," << l.prunes_bound_or
+        << "," << l.prunes_upperbounds
+        << "," << l.bound_time
+        << "," << l.slack_samples
+        << "," << (l.slack_samples == 0 ? 0.0 : l.slack_sum / l.slack_samples)
+        << "," << l.slack_unknown
+        << "\n";
+  }
+  return true;
+}
+
+#endif //BOUND_TELEMETRY_HPP
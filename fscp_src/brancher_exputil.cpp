@@ -8,11 +8,26 @@
 using namespace Gecode;
 using namespace std;
 
-void branch_exputil(Home home, const IntVarArgs& x, PolTreeState& poltree,
+void branch_exputil(Home home, const IntVarArgs& x, VarRanges& ranges, PolTreeState& poltree,
                     bool order_or_max, bool order_and_max, int depth_or, int depth_and) {
   if (home.failed()) return;
   ViewArray<Int::IntView> y(home,x);
-  BranchExpUtil::post(home,y,poltree,order_or_max,order_and_max,depth_or,depth_and);
+  BranchExpUtil::post(home,y,ranges,poltree,order_or_max,order_and_max,depth_or,depth_and);
+}
+
+// for timing the bounds (adaptive depth, telemetry)
+static inline double bound_clock()
+{
+  return AdaptiveDepth::now();
+}
+
+// the advisors of ConsAndAll run during eq(), while brch_commit_pos is set
+ModEvent BranchExpUtil::assign(Space& home, int pos, int val)
+{
+  poltree.brch_commit_pos = pos;
+  ModEvent me = vars[pos].eq(home, val);
+  poltree.brch_commit_pos = -1;
+  return me;
 }
 
 inline
@@ -23,7 +38,10 @@ void BranchExpUtil::reset_frompos(int pos)
   
   // reset evals of this and future nodes in policy tree (up to next AND)
   // because assigned ORs (if only one choice) are otherwise skipped
-  for (int i=pos; i!=size; i++) {
+  if (pos == size)
+    return;
+  int end = min(poltree.next_and[pos+1], size-1); // optimisation: up to next AND
+  for (int i=pos; i<=end; i++) {
     bool is_and = (varBNid[i] != -1);
     if (!is_and) { // OR node
       poltree.evals[i] = poltree.min_inf;
@@ -34,8 +52,6 @@ void BranchExpUtil::reset_frompos(int pos)
     } else { // AND node
       poltree.evals[i] = 0;
       poltree.lb[i] = poltree.min_inf;
-      if (i != pos)
-        break; // optimisation: up to next AND
     }
     //cout << "Choice init of evals["<<i<<"] (is_and:"<<is_and<<") = "<< poltree.evals[i] <<"\n";
   }
@@ -49,12 +65,36 @@ void BranchExpUtil::reset_frompos(int pos)
 Choice* BranchExpUtil::choice(Space& home)
 {
     reset_frompos(pos);
+    if (poltree.nogoods_on)
+      poltree.nogood_resolve(false); // the last committed child propagated fine
     
     const vector<int>& varBNid = poltree.varBNid;
     bool is_and = (varBNid[pos] != -1);
     
-    // determine value order
-    vector< std::pair<int,double> > score_val;
+    // first choice, on the root space: upper bound for the anytime search
+    if (poltree.root_bounds && poltree.root_ub == std::numeric_limits<double>::infinity())
+      poltree.root_ub = poltree.bound_or(ranges.mima(), 0, depth_or);
+    
+    // same subproblem solved before? then one alternative, that fails
+    if (!is_and && poltree.context_on && poltree.context_f && poltree.context_lookup(ranges.mima(), pos)) {
+      VarChoice* vc = new (1) VarChoice(*this, pos, 1, depth_and);
+      vc->resolved = true;
+      vc->vals[0] = vars[pos].min();
+      vc->upperbounds[0] = 0;
+      return vc;
+    }
+    
+    // bound depth, may be adapted per position
+    int d_and = depth_and;
+    bool adapt_and = (poltree.adaptive != NULL && depth_and > 0);
+    if (is_and && adapt_and)
+      d_and = poltree.adaptive->depth(pos);
+    
+    // determine value order (workspaces in poltree, to avoid memory allocation)
+    vector< std::pair<int,double> >& score_val = poltree.choice_scores;
+    vector< pair<int,int> >& evidence = poltree.choice_evidence; // varBNid,val (AND nodes only)
+    score_val.clear();
+    evidence.clear();
     if (!is_and) { // OR node, (will sort decreasing so positive if order_or_max, negative otherwise)
       /* 
        * Behrouz[xpl]: The entire domain of an integer variable can be accessed by a value iterator IntVarValues. 
@@ -62,11 +102,24 @@ Choice* BranchExpUtil::choice(Space& home)
        * operator ++i moves the iterator i to the next value, and i.val() returns the current value
        * of the iterator i 
        */
-      for (IntVarValues i(vars[pos]); i(); ++i) {
-        int v = i.val();
-        if (!order_or_max)
-          v = -v;
-        score_val.push_back( std::make_pair(i.val(), v) );
+      if (poltree.or_order_depth < 0) {
+        for (IntVarValues i(vars[pos]); i(); ++i) {
+          int v = i.val();
+          if (!order_or_max)
+            v = -v;
+          score_val.push_back( std::make_pair(i.val(), v) );
+        }
+      } else { // by bound, ties in the order above (stable sort below)
+        double start = bound_clock();
+        for (IntVarValues i(vars[pos]); i(); ++i)
+          score_val.push_back( std::make_pair(i.val(), 0.0) );
+        if (order_or_max)
+          std::reverse(score_val.begin(), score_val.end());
+        for (size_t i=0; i!=score_val.size(); i++)
+          score_val[i].second = poltree.bound_or_child(ranges.mima(), pos, score_val[i].first, poltree.or_order_depth);
+        poltree.or_order_nodes++;
+        poltree.or_order_bounds += score_val.size();
+        poltree.or_order_time += bound_clock() - start;
       }
       
     } else { // AND node, order based on expected utility bound, largest first
@@ -79,12 +132,11 @@ Choice* BranchExpUtil::choice(Space& home)
         }
       } else {
         // get probabilities
-        vector< pair<int,int> > evidence; // varBNid,val
-        for (int i=0; i!=pos; i++) {
-          if (varBNid[i] != -1) // earlier (assigned) AND node
-            evidence.push_back( std::make_pair(varBNid[i], vars[i].val()) );
+        for (int s=0; s!=poltree.and_prefix[pos]; s++) { // earlier (assigned) AND nodes
+          int i = poltree.and_positions[s];
+          evidence.push_back( std::make_pair(varBNid[i], vars[i].val()) );
         }
-        score_val = poltree.bn.var_partials(evidence, varBNid[pos]);
+        poltree.bn.var_partials(evidence, varBNid[pos], score_val);
         
         // remove 0 probabilities
         size_t lst = score_val.size();
@@ -95,24 +147,50 @@ Choice* BranchExpUtil::choice(Space& home)
         score_val.resize(lst);
         
         // replace probability by upper bounds on exputil
-        if (depth_and >= 0 && pos != 0 && poltree.lb[pos-1] != poltree.min_inf)
-          poltree.bounds_and(vars, pos, score_val, depth_and);
+        if (depth_and >= 0 && pos != 0 && poltree.lb[pos-1] != poltree.min_inf) {
+          bool timed = (adapt_and || poltree.telemetry != NULL);
+          double start = (timed ? bound_clock() : 0);
+          poltree.bounds_and(ranges.mima(), pos, score_val, d_and);
+          double secs = (timed ? bound_clock() - start : 0);
+          if (adapt_and)
+            poltree.adaptive->add_time(pos, d_and, secs);
+          if (poltree.telemetry != NULL)
+            poltree.telemetry->and_bounds(pos, secs);
+        }
       }
     }
     
-    // sort by score and put in vector
-    std::sort(score_val.begin(), score_val.end(), greater_second<int, double>());
-    vector<int> val_order;
-    vector<double> ubs;
-    for (auto it=score_val.begin(); it!=score_val.end(); ++it) {
-      val_order.push_back(it->first);
-      if (is_and)
-        ubs.push_back(it->second);
+ 
+    // sort by score and put in choice (the scores are upper bounds for AND
+    // nodes, and for OR nodes ordered by bound)
+    if (!is_and && poltree.or_order_depth >= 0)
+      std::stable_sort(score_val.begin(), score_val.end(), greater_second<int, double>());
+    else
+      std::sort(score_val.begin(), score_val.end(), greater_second<int, double>());
+    int n = score_val.size();
+    VarChoice* vc = new (n) VarChoice(*this, pos, n, d_and);
+    for (int i=0; i!=n; i++) {
+      vc->vals[i] = score_val[i].first;
+      vc->upperbounds[i] = score_val[i].second;
+    }
+    if (poltree.root_bounds && pos == 0 && !is_and) {
+      poltree.root_child_ub.resize(n);
+      for (int i=0; i!=n; i++)
+        poltree.root_child_ub[i] = poltree.bound_or_child(ranges.mima(), pos, vc->vals[i], depth_or);
+    }
+    
+    // let the prefetch thread work on the later siblings while we explore the first
+    if (is_and && depth_and >= 0 && poltree.bn.is_prefetching()) {
+      int next = poltree.next_and[pos+1];
+      if (next != vars.size()) {
+        for (int i=1; i<n; i++)
+          poltree.bn.prefetch(evidence, varBNid[pos], vc->vals[i], varBNid[next]);
+      }
     }
     
     if (poltree.verbose >= 5)
-      std::cout << "Saving "<<val_order.size()<<" choices for position "<<pos<<std::endl;
-    return new VarChoice(*this, pos, val_order, ubs);
+      std::cout << "Saving "<<n<<" choices for position "<<pos<<std::endl;
+    return vc;
 }
   
   // c is our Choice implementation
@@ -125,6 +203,29 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
     int bn_id = poltree.varBNid[pos];
     bool is_and = (bn_id != -1);
     int val = vc.vals[a];
+    if (poltree.nogoods_on)
+      poltree.nogood_resolve(true); // no choice() or leaf since the last commit
+    
+    // recomputation: the state of the policy tree was updated when this
+    // alternative was first committed, only the domain change is redone
+    if ((int)a <= vc.committed) {
+      poltree.replays++;
+      return me_failed(assign(home, pos, val)) ? ES_FAILED : ES_OK;
+    }
+    vc.committed = a;
+    
+    if (poltree.adaptive != NULL)
+      poltree.adaptive->enter(pos);
+    if (poltree.telemetry != NULL)
+      poltree.telemetry->close_from(pos, poltree.evals);
+    if (poltree.context_on)
+      poltree.context_close(pos+1); // the subtrees below an earlier value at pos
+    if (poltree.policy != NULL)
+      poltree.policy->commit(pos);
+    if (pos == 0)
+      poltree.root_child = a;
+    if (vc.resolved)
+      return ES_FAILED;
     
     // AND variable with non-first value, did the previous child succeed?
     if (is_and) {
@@ -137,7 +238,7 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
       
       // AND variable, store new choice of this child
       poltree.brch_rand_val[pos] = val;
-      if (a == vc.vals.size()-1)
+      if ((int)a == vc.n-1)
         poltree.brch_rand_lastval[pos] = true;
       else
         poltree.brch_rand_lastval[pos] = false;
@@ -145,16 +246,24 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
       reset_frompos(pos+1);
     }    
     
+    // known to fail in propagation?
+    if (!is_and && poltree.nogoods_on && poltree.context_f && poltree.nogood_check(ranges.mima(), pos, val))
+      return ES_FAILED;
+    
     // try branching
-    if (me_failed(vars[vc.id].eq(home, val)))
+    if (me_failed(assign(home, pos, val)))
       return ES_FAILED;
     
     // compute bound!
     if (is_and) { // AND node
       if (pos != 0 && poltree.lb[pos-1] != poltree.min_inf) { // not as first var, needs parent, and only if enabled
         // so many months later, I forgot why for AND the lb is pos-1? (no pruning for lb[pos]...)
-        if (depth_and == 0) { // simplest bound
-          double bnd = poltree.bound_or(vars, pos, 0); // at depth 0, same for OR and AND
+        int d_and = vc.depth;
+        if (d_and == 0) { // simplest bound
+          double start = (poltree.telemetry != NULL ? bound_clock() : 0);
+          double bnd = poltree.bound_or(ranges.mima(), pos, 0); // at depth 0, same for OR and AND
+          if (poltree.telemetry != NULL)
+            poltree.telemetry->or_bound(pos, bound_clock() - start, !(bnd > poltree.lb[pos-1]), bnd, poltree.lb[pos-1]);
           if (poltree.verbose >= 2)
             cout << "Bound for AND node (depth=0)"<<pos<<"\twith val: " << vars[pos].val() << " and lb " << poltree.lb[pos-1] << " :: " << bnd << "\n";
         
@@ -165,14 +274,19 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
             return ES_FAILED;
           }
         }
-        if (depth_and > 0) { // proper bound
+        if (d_and > 0) { // proper bound
           // lb = LB_node - \sum_seen val_seen - \sum_unseen UB_unseen
           double sum_ub_unseen = 0;
-          for (size_t x=a+1; x!=vc.upperbounds.size(); x++)
+          for (int x=a+1; x!=vc.n; x++)
             sum_ub_unseen += vc.upperbounds[x];
           double lb = poltree.lb[pos-1] - poltree.evals[pos] - sum_ub_unseen;
           // check that computed UB is > lb:
-          if (!(vc.upperbounds[a] > lb)) {
+          bool prune = !(vc.upperbounds[a] > lb);
+          if (poltree.adaptive != NULL)
+            poltree.adaptive->bound(pos, d_and, 0, prune); // time was added in choice()
+          if (poltree.telemetry != NULL)
+            poltree.telemetry->and_check(pos, prune);
+          if (prune) {
             if (poltree.verbose >= 2)
               cout << "And node pos="<<pos<<" with value "<<val<<": PRUNED (lb="<<lb<<" > "<<vc.upperbounds[a]<<")\n";
             return ES_FAILED;
@@ -184,9 +298,37 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
     } else { // OR node
       if (poltree.evals[pos] != poltree.min_inf) // previous child's val
         poltree.lb[pos] = poltree.evals[pos];
+      if (poltree.or_order_depth >= 0 && poltree.lb[pos] != poltree.min_inf && !(vc.upperbounds[a] > poltree.lb[pos])) {
+        // the bound of the value order, computed in choice()
+        poltree.or_order_prunes++;
+        if (poltree.verbose >= 2)
+          cout << "Pruning based on the bound of the value order\n";
+        return ES_FAILED;
+      }
+      if (poltree.lb[pos] != poltree.min_inf && poltree.lp_bound > 0 && poltree.lp_f) {
+        // LP relaxation of the remaining stages, checked first as it is cheaper than a deep bound
+        double bnd = poltree.bound_lp(ranges.mima(), pos);
+        if (poltree.verbose >= 2)
+          cout << "LP bound for OR node "<<pos<<"\twith val: " << vars[pos].val() << " and lb " << poltree.lb[pos] << " :: " << bnd << "\n";
+        if (!(bnd > poltree.lb[pos])) {
+          poltree.lp_prunes++;
+          if (poltree.verbose >= 2)
+            cout << "Pruning based on LP bound\n";
+          return ES_FAILED;
+        }
+      }
       if (poltree.lb[pos] != poltree.min_inf && depth_or >= 0) { // OR node with a bound and depth_or >= 0
+        bool adapt_or = (poltree.adaptive != NULL);
+        int d_or = (adapt_or ? poltree.adaptive->depth(pos) : depth_or);
+        bool timed = (adapt_or || poltree.telemetry != NULL);
+        double start = (timed ? bound_clock() : 0);
         
-        double bnd = poltree.bound_or(vars, pos, depth_or);
+        double bnd = poltree.bound_or(ranges.mima(), pos, d_or);
+        double secs = (timed ? bound_clock() - start : 0);
+        if (adapt_or)
+          poltree.adaptive->bound(pos, d_or, secs, !(bnd > poltree.lb[pos]));
+        if (poltree.telemetry != NULL)
+          poltree.telemetry->or_bound(pos, secs, !(bnd > poltree.lb[pos]), bnd, poltree.lb[pos]);
         if (poltree.verbose >= 2)
           cout << "Bound for OR node "<<pos<<"\twith val: " << vars[pos].val() << " and lb " << poltree.lb[pos] << " :: " << bnd << "\n";
         
@@ -199,6 +341,8 @@ ExecStatus BranchExpUtil::commit(Space& home, const Choice& c, unsigned int a)
       }
     }
     
+    if (!is_and && poltree.nogoods_on)
+      poltree.nogood_arm(); // learned if the propagation fails
     return ES_OK;
 }
 
@@ -6,6 +6,7 @@
 #include <gecode/int.hh>
 
 #include "policy_tree_state.h"
+#include "constraint_ranges.hpp"
 
 using namespace Gecode;
 
@@ -20,6 +21,7 @@ struct greater_second {
 
 void branch_exputil(Home home, 
                     const IntVarArgs& x, 
+                    VarRanges& ranges, // of x, see var_ranges()
                     PolTreeState& poltree, 
                     bool order_or_max, 
                     bool order_and_max, 
@@ -30,6 +32,7 @@ class BranchExpUtil : public Brancher {
 protected:
   // variables
   Gecode::ViewArray<Int::IntView> vars;
+  VarRanges ranges; // of vars, for the bounds
   
   // state
   PolTreeState& poltree;
@@ -39,21 +42,45 @@ protected:
   const int depth_or;
   const int depth_and;
   
+  // the values and bounds are stored right after the object, so that a
+  // choice is a single allocation: create with new (n) VarChoice(..., n, ...)
   class VarChoice : public Choice {
   public:
     int id;
-    std::vector<int> vals;
-    std::vector<double> upperbounds;
-    VarChoice(const BranchExpUtil& b, int id0, const std::vector<int>& vals0, const std::vector<double>& ubs)
-      : Choice(b, vals0.size()), id(id0), vals(vals0), upperbounds(ubs) {}
+    int n; // number of values
+    int depth; // bound depth used for the upperbounds (AND nodes)
+    // highest alternative committed so far, -1 if none; the search explores
+    // the alternatives in order, so committing one that is not higher is
+    // recomputation replaying the path (see commit())
+    mutable int committed;
+    bool resolved; // OR node resolved from the context cache, nothing to search
+    double* upperbounds; // n
+    int* vals; // n
+    VarChoice(const BranchExpUtil& b, int id0, int n0, int depth0)
+      : Choice(b, n0), id(id0), n(n0), depth(depth0), committed(-1), resolved(false) {
+      upperbounds = reinterpret_cast<double*>(this+1);
+      vals = reinterpret_cast<int*>(upperbounds+n);
+    }
+    static void* operator new(size_t s, int n) {
+      return Choice::operator new(s + n*(sizeof(double)+sizeof(int)));
+    }
+    static void operator delete(void* p) {
+      Choice::operator delete(p);
+    }
+    static void operator delete(void* p, int) { // if the constructor throws
+      Choice::operator delete(p);
+    }
     virtual size_t size(void) const {
-      return sizeof(*this);
+      return sizeof(*this) + n*(sizeof(double)+sizeof(int));
     }
     virtual void archive(Archive& e) const {
       Choice::archive(e);
       e << id;
-      e << (int)vals.size();
-      for(size_t i = 0; i < vals.size(); i++) {
+      e << depth;
+      e << resolved;
+      e << committed;
+      e << n;
+      for(int i = 0; i < n; i++) {
         e<<vals[i];
         e<<upperbounds[i];
       }
@@ -63,14 +90,14 @@ public:
   
   // for rand vars, we branch based on mass
   // for decision vars... min value (could be an option)
-  BranchExpUtil(Home home, ViewArray<Int::IntView>& vars0, PolTreeState& poltree0,
+  BranchExpUtil(Home home, ViewArray<Int::IntView>& vars0, VarRanges& ranges0, PolTreeState& poltree0,
                 bool order_or_max0, bool order_and_max0, int depth_or0, int depth_and0)
-    : Brancher(home), vars(vars0), poltree(poltree0), pos(0),
+    : Brancher(home), vars(vars0), ranges(ranges0), poltree(poltree0), pos(0),
       order_or_max(order_or_max0), order_and_max(order_and_max0), depth_or(depth_or0), depth_and(depth_and0) {}
     
-  static void post(Home home, ViewArray<Int::IntView>& vars, PolTreeState& poltree, 
+  static void post(Home home, ViewArray<Int::IntView>& vars, VarRanges& ranges, PolTreeState& poltree, 
                    bool order_or_max, bool order_and_max, int depth_or, int depth_and) {
-    (void) new (home) BranchExpUtil(home,vars,poltree,order_or_max,order_and_max,depth_or,depth_and);
+    (void) new (home) BranchExpUtil(home,vars,ranges,poltree,order_or_max,order_and_max,depth_or,depth_and);
   }
   
   virtual size_t dispose(Space& home) {
@@ -82,6 +109,7 @@ public:
     : Brancher(home,share,b), poltree(b.poltree), pos(b.pos), 
       order_or_max(b.order_or_max), order_and_max(b.order_and_max), depth_or(b.depth_or), depth_and(b.depth_and) {
     vars.update(home,share,b.vars);
+    ranges.update(home,share,b.ranges);
   }
   
   virtual Brancher* copy(Space& home, bool share) {
@@ -104,24 +132,26 @@ public:
    // something technical, depends on Choice* implementation
   virtual Choice* choice(const Space&, Archive& e) {
     int id;
+    int depth;
+    bool resolved;
+    int committed;
     int n;
-    e >> id >> n;
+    e >> id >> depth >> resolved >> committed >> n;
     
-    std::vector<int> vals;
-    vals.reserve(n);
+    VarChoice* vc = new (n) VarChoice(*this, id, n, depth);
+    vc->resolved = resolved;
+    vc->committed = committed; // from a checkpoint: its commits are replays
     int v;
-    std::vector<double> ubs;
-    ubs.reserve(n);
-    int ub;
+    double ub;
     
     for(int i=0; i < n; i++) {
       e >> v;
-      vals.push_back(v);
+      vc->vals[i] = v;
       e >> ub;
-      ubs.push_back(ub);
+      vc->upperbounds[i] = ub;
     }
     
-    return new VarChoice(*this, id, vals, ubs);
+    return vc;
   }
   
   // c is our Choice implementation
@@ -142,6 +172,8 @@ public:
   }
   
   void reset_frompos(int pos);
+  // vars[pos] = val, the only assignment of an AND var ConsAndAll accepts
+  ModEvent assign(Space& home, int pos, int val);
 };
 
 #endif
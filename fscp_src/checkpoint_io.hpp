@@ -0,0 +1,42 @@
+#ifndef CHECKPOINT_IO_HPP
+#define CHECKPOINT_IO_HPP
+
+#include <vector>
+#include <istream>
+#include <ostream>
+
+using std::vector;
+
+// raw binary reading and writing for the search checkpoints (native byte
+// order: a checkpoint is resumed on the machine that wrote it)
+template<class T>
+inline void ckp_put(std::ostream& os, const T& v)
+{
+  os.write(reinterpret_cast<const char*>(&v), sizeof(T));
+}
+
+template<class T>
+inline bool ckp_get(std::istream& is, T& v)
+{
+  return (bool)is.read(reinterpret_cast<char*>(&v), sizeof(T));
+}
+
+template<class T>
+inline void ckp_put(std::ostream& os, const vector<T>& v)
+{
+  ckp_put(os, (unsigned long int)v.size());
+  if (!v.empty())
+    os.write(reinterpret_cast<const char*>(&v[0]), v.size()*sizeof(T));
+}
+
+// the size must match, the vectors are sized by the model
+template<class T>
+inline bool ckp_get(std::istream& is, vector<T>& v)
+{
+  unsigned long int n;
+  if (!ckp_get(is, n) || n != v.size())
+    return false;
+  return n == 0 || (bool)is.read(reinterpret_cast<char*>(&v[0]), n*sizeof(T));
+}
+
+#endif //CHECKPOINT_IO_HPP
@@ -43,36 +43,41 @@ void and_nodes_all(Gecode::Space& home,
 
 
 template <class VA>
-ExecStatus ConsAndAll<VA>::propagate(Space& home, const ModEventDelta& )
+bool ConsAndAll<VA>::check_brancher(int val, int idx, const PolTreeState& poltree)
 {
-  //TODO: would make for a perfect advisor propagator... (each var independently)
-  if (home.failed())
-    return home.ES_SUBSUMED(*this);
-  
-  int vars_size = and_vars.size();
-  
-  // for all assigned AND nodes: check that the brancher chose this value (if not: some world is impossible)
-  while (pos != vars_size && and_vars[pos].assigned()) {
-    int idx = and_idx[pos];
-    if (poltree.brch_rand_val[idx] != and_vars[pos].val()) {
-      if (poltree.verbose >= 2)
-        cout << "and_var["<<pos<<"] idx="<<idx<<" is not the same as given by brancher: "<<poltree.brch_rand_val[idx]<<"\n";
-      return ES_FAILED;
-    }
-    pos++;
+  // only the commit under way (also when replayed by recomputation, which
+  // does not set brch_rand_val again), see BranchExpUtil::assign()
+  if (poltree.brch_commit_pos != idx) {
+    if (poltree.verbose >= 2)
+      cout << "and_var idx="<<idx<<" val="<<val<<" is not assigned by the brancher\n";
+    return false;
   }
+  return true;
+}
+
+template <class VA>
+ExecStatus ConsAndAll<VA>::advise(Space& home, Advisor& a, const Delta& )
+{
+  AndAdvisor& aa = static_cast<AndAdvisor&>(a);
+  int i = aa.i;
   
-  // for all remaining AND nodes, check that full domain
-  // if not, a possible world is impossible and we can already backtrack...
-  for (int x=pos; x!=vars_size; x++) {
-    int idx = and_idx[x];
-    if (and_vars[x].size() != (size_t)and_size[x]) {
-      if (poltree.verbose >= 2)
-        cout << "NO MATCH var["<<x<<"] idx="<<idx<<", " << and_vars[x] << " size: "<<and_vars[x].size()<<" vs domsize " << and_size[x] << "\n";
+  // assigned AND node: check that the brancher did it (if not: some world is impossible)
+  if (and_vars[i].assigned()) {
+    if (!check_brancher(and_vars[i].val(), and_idx[i], poltree))
       return ES_FAILED;
-    }
+    // no more changes to advise on; once the last one is gone, propagate() subsumes
+    return (--unassigned == 0 ? home.ES_NOFIX_DISPOSE(c,aa) : home.ES_FIX_DISPOSE(c,aa));
   }
   
-  return ES_FIX;
+  // any other change: not the full domain anymore, a possible world is impossible
+  if (poltree.verbose >= 2)
+    cout << "NO MATCH var["<<and_idx[i]<<"] " << and_vars[i] << " size: "<<and_vars[i].size()<<" vs domsize " << and_size[i] << "\n";
+  return ES_FAILED;
 }
 
+template <class VA>
+ExecStatus ConsAndAll<VA>::propagate(Space& home, const ModEventDelta& )
+{
+  // only scheduled by the advisor of the last AND var to be assigned
+  return home.ES_SUBSUMED(*this);
+}
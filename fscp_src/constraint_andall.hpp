@@ -21,17 +21,39 @@ void and_nodes_all(Gecode::Space& home,
                   );
 
 // propagator definition
+//
+// Every AND var must keep its full domain until the brancher assigns it
+// (brch_commit_pos, any other assignment is forced by propagation). Each var has its own advisor, so a domain
+// change is checked in O(1) for that var alone instead of rescanning all AND
+// vars: a pruned but unassigned var fails right away, an assigned var is
+// checked against the brancher once and its advisor is disposed.
+// propagate() only runs when all of them are, to subsume the propagator.
 template <class VA>
 class ConsAndAll : public Gecode::Propagator {
 protected:
+    // advisor of and_vars[i]
+    class AndAdvisor : public Gecode::Advisor {
+    public:
+      int i;
+      AndAdvisor(Gecode::Space& home, Gecode::Propagator& p,
+                 Gecode::Council<AndAdvisor>& c, int i0)
+        : Advisor(home,p,c), i(i0) {}
+      AndAdvisor(Gecode::Space& home, bool share, AndAdvisor& a)
+        : Advisor(home,share,a), i(a.i) {}
+    };
+
     // variables
     Gecode::ViewArray<VA> and_vars;
     Gecode::IntSharedArray and_idx;
     Gecode::IntSharedArray and_size;
     
-    int pos; // first unassigned and_var (initially 0)
+    Gecode::Council<AndAdvisor> c;
+    int unassigned; // and_vars with an advisor
     const PolTreeState& poltree;
 
+    // whether value val of the AND var at position idx is the brancher's commit under way
+    static bool check_brancher(int val, int idx, const PolTreeState& poltree);
+
 public:
     // posting
     static Gecode::ExecStatus post(Gecode::Space& home,
@@ -40,7 +62,18 @@ public:
                                    Gecode::IntSharedArray& and_size,
                                    const PolTreeState& poltree
                                   ) {
-      (void) new (home) ConsAndAll<VA>(home,and_vars,and_idx,and_size,poltree);
+      // the initial domains, later changes go to the advisors
+      int unassigned = 0;
+      for (int i=0; i!=and_vars.size(); i++) {
+        if (and_vars[i].size() == (unsigned int)and_size[i]) {
+          if (!and_vars[i].assigned())
+            unassigned++;
+        } else if (!and_vars[i].assigned() || !check_brancher(and_vars[i].val(), and_idx[i], poltree)) {
+          return Gecode::ES_FAILED;
+        }
+      }
+      if (unassigned != 0)
+        (void) new (home) ConsAndAll<VA>(home,and_vars,and_idx,and_size,poltree);
       return Gecode::ES_OK;
     }
     
@@ -51,21 +84,28 @@ public:
                Gecode::IntSharedArray& and_size0,
                const PolTreeState& poltree0
                )
-    : Propagator(home), and_vars(and_vars0), and_idx(and_idx0), and_size(and_size0), pos(0), poltree(poltree0)
+    : Propagator(home), and_vars(and_vars0), and_idx(and_idx0), and_size(and_size0), c(home), unassigned(0), poltree(poltree0)
     {
-      and_vars.subscribe(home,*this,Gecode::Int::PC_INT_DOM);
+      for (int i=0; i!=and_vars.size(); i++)
+        if (!and_vars[i].assigned()) {
+          and_vars[i].subscribe(home,*new (home) AndAdvisor(home,*this,c,i));
+          unassigned++;
+        }
     }
     
     // copy constructor
     ConsAndAll(Gecode::Space& home, bool share, ConsAndAll& p)
-    : Propagator(home,share,p), and_idx(p.and_idx), and_size(p.and_size), pos(p.pos), poltree(p.poltree)
+    : Propagator(home,share,p), and_idx(p.and_idx), and_size(p.and_size), unassigned(p.unassigned), poltree(p.poltree)
     {
       and_vars.update(home,share,p.and_vars);
+      c.update(home,share,p.c);
     }
     
     virtual size_t dispose(Gecode::Space& home)
     {
-      and_vars.cancel(home,*this,Gecode::Int::PC_INT_VAL);
+      for (Gecode::Advisors<AndAdvisor> as(c); as(); ++as)
+        and_vars[as.advisor().i].cancel(home,as.advisor());
+      c.dispose(home);
       (void) Propagator::dispose(home);
       return sizeof(*this);
     }
@@ -77,10 +117,12 @@ public:
 
     virtual Gecode::PropCost cost(const Gecode::Space&, const Gecode::ModEventDelta&) const
     {
-      // run as last
-      return Gecode::PropCost::linear(Gecode::PropCost::LO, and_vars.size());
+      // the advisors do the work
+      return Gecode::PropCost::unary(Gecode::PropCost::LO);
     }
     
+    // one and_var changed
+    virtual Gecode::ExecStatus advise(Gecode::Space& home, Gecode::Advisor& a, const Gecode::Delta& d);
   
     // propagation
     virtual Gecode::ExecStatus propagate(Gecode::Space& home, const Gecode::ModEventDelta&);    
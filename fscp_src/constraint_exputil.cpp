@@ -0,0 +1,73 @@
+//
+// constraint_exputil.cpp
+//
+// prune decisions on their expected utility bound
+// 
+
+#include "constraint_exputil.hpp"
+
+using namespace Gecode; 
+using namespace Int;
+using namespace std; 
+
+
+// constraint post function
+void exputil_prune(Gecode::Space& home,
+                   const Gecode::IntVarArgs& vars,
+                   VarRanges& ranges,
+                   PolTreeState& poltree
+) {
+  if (home.failed()) return;
+  if (poltree.prop_depth < 0) return;
+  
+  ViewArray<IntView> vars0(home, vars);
+  GECODE_ES_FAIL((ConsExpUtil<IntView>::post(home, vars0, ranges, poltree)));
+}
+
+
+template <class VA>
+ExecStatus ConsExpUtil<VA>::propagate(Space& home, const ModEventDelta& )
+{
+  int vars_size = vars.size();
+  vector<int>& prune = poltree.prop_vals;
+  
+  while (true) {
+    while (pos != vars_size && vars[pos].assigned())
+      pos++;
+    if (pos == vars_size)
+      return home.ES_SUBSUMED(*this);
+    // AND nodes keep their full domain, the next OR node needs a lower bound
+    if (poltree.varBNid[pos] != -1 || pos == 0)
+      return ES_FIX;
+    double lb = poltree.lb[pos-1];
+    if (lb == poltree.min_inf)
+      return ES_FIX;
+    if (pos == done_pos && !(lb > done_lb))
+      return ES_FIX; // filtered with this lower bound already
+    done_pos = pos;
+    done_lb = lb;
+    poltree.prop_runs++;
+    
+    prune.clear();
+    for (ViewValues<VA> i(vars[pos]); i(); ++i) {
+      double bnd = poltree.bound_or_child(ranges.mima(), pos, i.val(), poltree.prop_depth);
+      if (poltree.verbose >= 3)
+        cout << "Propagator bound for OR node "<<pos<<"\twith val: " << i.val() << " and lb " << lb << " :: " << bnd << "\n";
+      if (!(bnd > lb))
+        prune.push_back(i.val());
+    }
+    poltree.prop_bounds += vars[pos].size();
+    if (prune.empty())
+      return ES_FIX;
+    
+    // the failures below now depend on the lower bound, they are no nogoods
+    if (poltree.nogoods_on)
+      poltree.nogood_disarm();
+    poltree.prop_prunes += prune.size();
+    if (poltree.verbose >= 2)
+      cout << "Propagator pruned "<<prune.size()<<" values of OR node "<<pos<<"\n";
+    for (size_t i=0; i!=prune.size(); i++)
+      GECODE_ME_CHECK(vars[pos].nq(home, prune[i]));
+    // assigned: on to the next node
+  }
+}
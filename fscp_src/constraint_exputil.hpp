@@ -0,0 +1,95 @@
+//
+// constraint to prune decisions on their expected utility bound
+// 
+
+#ifndef _CONS_EXPUTIL_HPP_
+#define _CONS_EXPUTIL_HPP_
+
+#include <gecode/int.hh>
+
+#include "policy_tree_state.h"
+#include "constraint_ranges.hpp"
+
+// post constraint (if poltree.prop_depth >= 0)
+void exputil_prune(Gecode::Space& home,
+                   const Gecode::IntVarArgs& vars, // array with decision and random variables
+                   VarRanges& ranges, // of vars, see var_ranges()
+                   PolTreeState& poltree // the policy tree state
+                  );
+
+// propagator definition
+//
+// The brancher prunes a value of an OR node in commit, once it is chosen, if
+// bound_or() can not beat the lower bound of the node. This propagator does
+// the same for all values of the first unassigned OR node at once, before the
+// brancher gets to it, so that the other propagators work on its reduced
+// domain. The lower bound is the one the brancher starts that node with
+// (lb of the position before it, see BranchExpUtil::reset_frompos), and is
+// re-read whenever a commit assigns a variable.
+template <class VA>
+class ConsExpUtil : public Gecode::Propagator {
+protected:
+    // variables
+    Gecode::ViewArray<VA> vars;
+    VarRanges ranges; // of vars, for the bounds
+    
+    int pos; // first unassigned var (initially 0)
+    int done_pos; // position and lower bound of the last filtering, -1 if none
+    double done_lb;
+    PolTreeState& poltree;
+
+public:
+    // posting
+    static Gecode::ExecStatus post(Gecode::Space& home,
+                                   Gecode::ViewArray<VA>& vars,
+                                   VarRanges& ranges,
+                                   PolTreeState& poltree
+                                  ) {
+      (void) new (home) ConsExpUtil<VA>(home,vars,ranges,poltree);
+      return Gecode::ES_OK;
+    }
+    
+    // post constructor
+    ConsExpUtil(Gecode::Space& home,
+                Gecode::ViewArray<VA>& vars0,
+                VarRanges& ranges0,
+                PolTreeState& poltree0
+               )
+    : Propagator(home), vars(vars0), ranges(ranges0), pos(0), done_pos(-1), done_lb(0), poltree(poltree0)
+    {
+      vars.subscribe(home,*this,Gecode::Int::PC_INT_VAL);
+    }
+    
+    // copy constructor
+    ConsExpUtil(Gecode::Space& home, bool share, ConsExpUtil& p)
+    : Propagator(home,share,p), pos(p.pos), done_pos(p.done_pos), done_lb(p.done_lb), poltree(p.poltree)
+    {
+      vars.update(home,share,p.vars);
+      ranges.update(home,share,p.ranges);
+    }
+    
+    virtual size_t dispose(Gecode::Space& home)
+    {
+      vars.cancel(home,*this,Gecode::Int::PC_INT_VAL);
+      (void) Propagator::dispose(home);
+      return sizeof(*this);
+    }
+
+    virtual Gecode::Propagator* copy(Gecode::Space& home, bool share)
+    {
+      return new (home) ConsExpUtil<VA>(home,share,*this);
+    }
+
+    virtual Gecode::PropCost cost(const Gecode::Space&, const Gecode::ModEventDelta&) const
+    {
+      // a bound per value, after the model constraints
+      return Gecode::PropCost::linear(Gecode::PropCost::HI, vars.size());
+    }
+    
+  
+    // propagation
+    virtual Gecode::ExecStatus propagate(Gecode::Space& home, const Gecode::ModEventDelta&);    
+    
+};
+
+#endif
@@ -0,0 +1,263 @@
+//
+// constraint_prodsum.cpp
+//
+// sum_i c_i * x_i * y_i REL z, with x_i 0/1
+// 
+
+#include <algorithm>
+
+#include "constraint_prodsum.hpp"
+
+using namespace Gecode; 
+using namespace Int;
+using namespace std; 
+
+
+// rounded down (resp. up) a/b
+static inline long long floor_div(long long a, long long b)
+{
+  long long q = a/b;
+  if (a % b != 0 && ((a < 0) != (b < 0)))
+    q--;
+  return q;
+}
+static inline long long ceil_div(long long a, long long b)
+{
+  return -floor_div(-a, b);
+}
+
+// the views of the terms with a non-zero coefficient, x restricted to 0/1
+static bool prod_sum_views(Space& home, const IntArgs& c, const IntVarArgs& x, const IntVarArgs& y,
+                           ViewArray<IntView>& xv, ViewArray<IntView>& yv, IntSharedArray& cv)
+{
+  if (c.size() != x.size() || c.size() != y.size())
+    throw Int::ArgumentSizeMismatch("prod_sum");
+  IntVarArgs xs, ys;
+  IntArgs cs;
+  for (int i=0; i!=c.size(); i++) {
+    if (c[i] == 0)
+      continue;
+    xs << x[i];
+    ys << y[i];
+    cs << c[i];
+  }
+  xv = ViewArray<IntView>(home, xs);
+  yv = ViewArray<IntView>(home, ys);
+  cv = IntSharedArray(cs);
+  for (int i=0; i!=xv.size(); i++)
+    if (me_failed(xv[i].gq(home, 0)) || me_failed(xv[i].lq(home, 1)))
+      return false;
+  return true;
+}
+
+#ifdef PRODSUM_DECOMPOSE
+// the decomposition ProdSum replaces: x_i in [0,1], t_i = x_i*y_i with
+// mult(), and the caller posts linear() on t; only built for the comparison
+// runs of 'make check_prodsum'
+static IntVarArgs prod_sum_decomposed(Space& home, const IntArgs& c, const IntVarArgs& x, const IntVarArgs& y)
+{
+  if (c.size() != x.size() || c.size() != y.size())
+    throw Int::ArgumentSizeMismatch("prod_sum");
+  IntVarArgs t;
+  for (int i=0; i!=x.size(); i++) {
+    rel(home, x[i], IRT_GQ, 0);
+    rel(home, x[i], IRT_LQ, 1);
+    IntVar ti(home, Int::Limits::min, Int::Limits::max);
+    mult(home, x[i], y[i], ti);
+    t << ti;
+  }
+  return t;
+}
+#endif //PRODSUM_DECOMPOSE
+
+// constraint post functions
+void prod_sum(Gecode::Space& home,
+              const Gecode::IntArgs& c,
+              const Gecode::IntVarArgs& x,
+              const Gecode::IntVarArgs& y,
+              Gecode::IntRelType irt,
+              Gecode::IntVar z
+) {
+  if (home.failed()) return;
+  if (irt != IRT_EQ && irt != IRT_LQ && irt != IRT_GQ)
+    throw Int::UnknownRelation("prod_sum");
+#ifdef PRODSUM_DECOMPOSE
+  linear(home, c, prod_sum_decomposed(home, c, x, y), irt, z);
+  return;
+#endif //PRODSUM_DECOMPOSE
+  
+  ViewArray<IntView> xv, yv;
+  IntSharedArray cv;
+  if (!prod_sum_views(home, c, x, y, xv, yv, cv)) {
+    home.fail();
+    return;
+  }
+  GECODE_ES_FAIL((ProdSum<IntView>::post(home, xv, yv, cv, IntView(z), irt)));
+}
+
+void prod_sum(Gecode::Space& home,
+              const Gecode::IntArgs& c,
+              const Gecode::IntVarArgs& x,
+              const Gecode::IntVarArgs& y,
+              Gecode::IntRelType irt,
+              int k
+) {
+  if (home.failed()) return;
+  switch (irt) {
+    case IRT_LE: irt = IRT_LQ; k--; break;
+    case IRT_GR: irt = IRT_GQ; k++; break;
+    case IRT_EQ: case IRT_LQ: case IRT_GQ: break;
+    default: throw Int::UnknownRelation("prod_sum");
+  }
+#ifdef PRODSUM_DECOMPOSE
+  linear(home, c, prod_sum_decomposed(home, c, x, y), irt, k);
+  return;
+#endif //PRODSUM_DECOMPOSE
+  
+  ViewArray<IntView> xv, yv;
+  IntSharedArray cv;
+  if (!prod_sum_views(home, c, x, y, xv, yv, cv)) {
+    home.fail();
+    return;
+  }
+  GECODE_ES_FAIL((ProdSum<ConstIntView>::post(home, xv, yv, cv, ConstIntView(k), irt)));
+}
+
+
+template <class VZ>
+void ProdSum<VZ>::term_bounds(int i, long long& lo, long long& hi) const
+{
+  long long p[4] = { (long long)x[i].min()*y[i].min(), (long long)x[i].min()*y[i].max(),
+                     (long long)x[i].max()*y[i].min(), (long long)x[i].max()*y[i].max() };
+  lo = *min_element(p, p+4) * c[i];
+  hi = *max_element(p, p+4) * c[i];
+  if (c[i] < 0)
+    swap(lo, hi);
+}
+
+template <class VZ>
+ModEvent ProdSum<VZ>::term_lq(Space& home, int i, long long b)
+{
+  if (c[i] > 0)
+    return prod_lq(home, i, floor_div(b, c[i]));
+  return prod_gq(home, i, ceil_div(b, c[i]));
+}
+
+template <class VZ>
+ModEvent ProdSum<VZ>::term_gq(Space& home, int i, long long b)
+{
+  if (c[i] > 0)
+    return prod_gq(home, i, ceil_div(b, c[i]));
+  return prod_lq(home, i, floor_div(b, c[i]));
+}
+
+template <class VZ>
+ModEvent ProdSum<VZ>::prod_lq(Space& home, int i, long long m)
+{
+  // the bound for y[i], clipped to its domain (-1 below it: fails)
+  int ym = (int)max(min(m, (long long)y[i].max()), (long long)y[i].min()-1);
+  if (m < 0) { // x[i]=0 gives 0 > m
+    ModEvent me = x[i].eq(home, 1);
+    if (me_failed(me))
+      return me;
+    ModEvent me2 = y[i].lq(home, ym);
+    return (me_failed(me2) || me_modified(me2) ? me2 : me);
+  }
+  if (x[i].max() == 0)
+    return ME_INT_NONE;
+  if (y[i].min() > m)
+    return x[i].eq(home, 0);
+  if (x[i].min() == 1)
+    return y[i].lq(home, ym);
+  return ME_INT_NONE;
+}
+
+template <class VZ>
+ModEvent ProdSum<VZ>::prod_gq(Space& home, int i, long long m)
+{
+  // the bound for y[i], clipped to its domain (+1 above it: fails)
+  int ym = (int)min(max(m, (long long)y[i].min()), (long long)y[i].max()+1);
+  if (m > 0) { // x[i]=0 gives 0 < m
+    ModEvent me = x[i].eq(home, 1);
+    if (me_failed(me))
+      return me;
+    ModEvent me2 = y[i].gq(home, ym);
+    return (me_failed(me2) || me_modified(me2) ? me2 : me);
+  }
+  if (x[i].max() == 0)
+    return ME_INT_NONE;
+  if (y[i].max() < m)
+    return x[i].eq(home, 0);
+  if (x[i].min() == 1)
+    return y[i].gq(home, ym);
+  return ME_INT_NONE;
+}
+
+template <class VZ>
+ExecStatus ProdSum<VZ>::propagate(Space& home, const ModEventDelta& )
+{
+  int n = x.size();
+  bool changed;
+  do {
+    changed = false;
+    
+    // bounds of the sum
+    long long lo_sum = 0, hi_sum = 0;
+    bool assigned = z.assigned();
+    for (int i=0; i!=n; i++) {
+      long long lo, hi;
+      term_bounds(i, lo, hi);
+      lo_sum += lo;
+      hi_sum += hi;
+      assigned = assigned && x[i].assigned() && y[i].assigned();
+    }
+    
+    // sum <= z
+    if (irt != IRT_GQ) {
+      if (lo_sum > z.max())
+        return ES_FAILED;
+      if (lo_sum > z.min()) {
+        ModEvent me = z.gq(home, (int)lo_sum);
+        GECODE_ME_CHECK(me);
+        changed = changed || me_modified(me);
+      }
+      // each term at most what the others leave
+      for (int i=0; i!=n; i++) {
+        long long lo, hi;
+        term_bounds(i, lo, hi);
+        long long b = z.max() - (lo_sum - lo);
+        if (hi > b) {
+          ModEvent me = term_lq(home, i, b);
+          GECODE_ME_CHECK(me);
+          changed = changed || me_modified(me);
+        }
+      }
+    }
+    // sum >= z
+    if (irt != IRT_LQ) {
+      if (hi_sum < z.min())
+        return ES_FAILED;
+      if (hi_sum < z.max()) {
+        // the section above used the old z.max(), so not a fixpoint yet
+        ModEvent me = z.lq(home, (int)hi_sum);
+        GECODE_ME_CHECK(me);
+        changed = changed || me_modified(me);
+      }
+      for (int i=0; i!=n; i++) {
+        long long lo, hi;
+        term_bounds(i, lo, hi);
+        long long b = z.min() - (hi_sum - hi);
+        if (lo < b) {
+          ModEvent me = term_gq(home, i, b);
+          GECODE_ME_CHECK(me);
+          changed = changed || me_modified(me);
+        }
+      }
+    }
+    
+    if (assigned)
+      return home.ES_SUBSUMED(*this);
+  } while (changed);
+  
+  return ES_FIX;
+}
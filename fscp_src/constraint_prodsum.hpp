@@ -0,0 +1,114 @@
+//
+// constraint sum_i c_i * x_i * y_i REL z, with x_i 0/1
+// 
+
+#ifndef _CONS_PRODSUM_HPP_
+#define _CONS_PRODSUM_HPP_
+
+#include <gecode/int.hh>
+
+// post constraint, irt is IRT_EQ, IRT_LQ or IRT_GQ
+void prod_sum(Gecode::Space& home,
+              const Gecode::IntArgs& c, // coefficients
+              const Gecode::IntVarArgs& x, // 0/1 variables
+              const Gecode::IntVarArgs& y, // integer variables
+              Gecode::IntRelType irt,
+              Gecode::IntVar z
+             );
+// same, with a constant (also IRT_LE and IRT_GR)
+void prod_sum(Gecode::Space& home,
+              const Gecode::IntArgs& c,
+              const Gecode::IntVarArgs& x,
+              const Gecode::IntVarArgs& y,
+              Gecode::IntRelType irt,
+              int k
+             );
+
+// propagator definition
+//
+// Bounds consistent on the products as a whole, without the auxiliary
+// variable and propagator per product that mult() and linear() need: each
+// term c_i*x_i*y_i is bounded by what the other terms leave of z, and that
+// bound is pushed to x_i (0 if y_i can not meet it) or to y_i (if x_i is 1).
+template <class VZ>
+class ProdSum : public Gecode::Propagator {
+protected:
+    // variables
+    Gecode::ViewArray<Gecode::Int::IntView> x;
+    Gecode::ViewArray<Gecode::Int::IntView> y;
+    Gecode::IntSharedArray c; // non-zero
+    VZ z;
+    Gecode::IntRelType irt;
+    
+    // bounds of c[i]*x[i]*y[i]
+    void term_bounds(int i, long long& lo, long long& hi) const;
+    // c[i]*x[i]*y[i] <= b (resp. >= b)
+    Gecode::ModEvent term_lq(Gecode::Space& home, int i, long long b);
+    Gecode::ModEvent term_gq(Gecode::Space& home, int i, long long b);
+    // x[i]*y[i] <= m (resp. >= m)
+    Gecode::ModEvent prod_lq(Gecode::Space& home, int i, long long m);
+    Gecode::ModEvent prod_gq(Gecode::Space& home, int i, long long m);
+
+public:
+    // posting
+    static Gecode::ExecStatus post(Gecode::Space& home,
+                                   Gecode::ViewArray<Gecode::Int::IntView>& x,
+                                   Gecode::ViewArray<Gecode::Int::IntView>& y,
+                                   Gecode::IntSharedArray& c,
+                                   VZ z,
+                                   Gecode::IntRelType irt
+                                  ) {
+      (void) new (home) ProdSum<VZ>(home,x,y,c,z,irt);
+      return Gecode::ES_OK;
+    }
+    
+    // post constructor
+    ProdSum(Gecode::Space& home,
+            Gecode::ViewArray<Gecode::Int::IntView>& x0,
+            Gecode::ViewArray<Gecode::Int::IntView>& y0,
+            Gecode::IntSharedArray& c0,
+            VZ z0,
+            Gecode::IntRelType irt0
+           )
+    : Propagator(home), x(x0), y(y0), c(c0), z(z0), irt(irt0)
+    {
+      x.subscribe(home,*this,Gecode::Int::PC_INT_BND);
+      y.subscribe(home,*this,Gecode::Int::PC_INT_BND);
+      z.subscribe(home,*this,Gecode::Int::PC_INT_BND);
+    }
+    
+    // copy constructor
+    ProdSum(Gecode::Space& home, bool share, ProdSum& p)
+    : Propagator(home,share,p), c(p.c), irt(p.irt)
+    {
+      x.update(home,share,p.x);
+      y.update(home,share,p.y);
+      z.update(home,share,p.z);
+    }
+    
+    virtual size_t dispose(Gecode::Space& home)
+    {
+      x.cancel(home,*this,Gecode::Int::PC_INT_BND);
+      y.cancel(home,*this,Gecode::Int::PC_INT_BND);
+      z.cancel(home,*this,Gecode::Int::PC_INT_BND);
+      (void) Propagator::dispose(home);
+      return sizeof(*this);
+    }
+
+    virtual Gecode::Propagator* copy(Gecode::Space& home, bool share)
+    {
+      return new (home) ProdSum<VZ>(home,share,*this);
+    }
+
+    virtual Gecode::PropCost cost(const Gecode::Space&, const Gecode::ModEventDelta&) const
+    {
+      return Gecode::PropCost::linear(Gecode::PropCost::LO, x.size());
+    }
+    
+  
+    // propagation
+    virtual Gecode::ExecStatus propagate(Gecode::Space& home, const Gecode::ModEventDelta&);    
+    
+};
+
+#endif
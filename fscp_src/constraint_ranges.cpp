@@ -0,0 +1,49 @@
+//
+// constraint_ranges.cpp
+//
+// keep the <min,max> ranges of the variables up to date
+// 
+
+#include "constraint_ranges.hpp"
+
+using namespace Gecode; 
+using namespace Int;
+using namespace std; 
+
+
+// constraint post function
+VarRanges var_ranges(Gecode::Space& home,
+                     const Gecode::IntVarArgs& vars
+) {
+  VarRanges ranges(home, vars.size());
+  if (home.failed()) return ranges;
+  
+  ViewArray<IntView> vars0(home, vars);
+  if (ConsRanges<IntView>::post(home, vars0, ranges) == ES_FAILED)
+    home.fail();
+  return ranges;
+}
+
+
+template <class VA>
+ExecStatus ConsRanges<VA>::advise(Space& home, Advisor& a, const Delta& )
+{
+  RangeAdvisor& ra = static_cast<RangeAdvisor&>(a);
+  int i = ra.i;
+  
+  pair<int,int>& mima = ranges.mima()[i];
+  mima.first = vars[i].min();
+  mima.second = vars[i].max();
+  
+  if (vars[i].assigned())
+    // no more changes to advise on; once the last one is gone, propagate() subsumes
+    return (--unassigned == 0 ? home.ES_NOFIX_DISPOSE(c,ra) : home.ES_FIX_DISPOSE(c,ra));
+  return ES_FIX;
+}
+
+template <class VA>
+ExecStatus ConsRanges<VA>::propagate(Space& home, const ModEventDelta& )
+{
+  // only scheduled by the advisor of the last var to be assigned
+  return home.ES_SUBSUMED(*this);
+}
@@ -0,0 +1,160 @@
+//
+// <min,max> ranges of the variables, kept up to date in the space
+//
+
+#ifndef _CONS_RANGES_HPP_
+#define _CONS_RANGES_HPP_
+
+#include <gecode/int.hh>
+
+#include <vector>
+#include <utility>
+
+// The ranges of all variables, as the bound routines of PolTreeState take
+// them. They belong to the space and are cloned with it; the brancher and
+// ConsExpUtil hold a handle to them, and ConsRanges updates the range of a
+// variable whenever its domain changes, so reading them is O(1) instead of
+// copying min and max of every variable at every bound.
+class VarRanges : public Gecode::LocalHandle {
+protected:
+    class Object : public Gecode::LocalObject {
+    public:
+      std::vector< std::pair<int,int> > mima;
+      Object(Gecode::Space& home, int n)
+        : LocalObject(home), mima(n) {
+        home.notice(*this,Gecode::AP_DISPOSE);
+      }
+      Object(Gecode::Space& home, bool share, Object& o)
+        : LocalObject(home,share,o), mima(o.mima) {
+        home.notice(*this,Gecode::AP_DISPOSE);
+      }
+      virtual Gecode::Actor* copy(Gecode::Space& home, bool share) {
+        return new (home) Object(home,share,*this);
+      }
+      virtual size_t dispose(Gecode::Space& home) {
+        home.ignore(*this,Gecode::AP_DISPOSE);
+        std::vector< std::pair<int,int> >().swap(mima);
+        return sizeof(*this);
+      }
+    };
+public:
+    VarRanges(void) {}
+    VarRanges(Gecode::Space& home, int n)
+      : LocalHandle(new (home) Object(home,n)) {}
+    VarRanges(const VarRanges& r)
+      : LocalHandle(r) {}
+    VarRanges& operator =(const VarRanges& r) {
+      LocalHandle::operator =(r);
+      return *this;
+    }
+    void update(Gecode::Space& home, bool share, VarRanges& r) {
+      LocalHandle::update(home,share,r);
+    }
+    // the bound routines change entries while they run, and restore them
+    std::vector< std::pair<int,int> >& mima(void) const {
+      return static_cast<Object*>(object())->mima;
+    }
+};
+
+// post constraint, returns the ranges to give to exputil_prune and branch_exputil
+VarRanges var_ranges(Gecode::Space& home,
+                     const Gecode::IntVarArgs& vars // array with decision and random variables
+                    );
+
+// propagator definition
+//
+// Only its advisors do something: each one copies the new range of its var
+// into the ranges, and is disposed once the var is assigned. propagate() only
+// runs when all of them are, to subsume the propagator.
+template <class VA>
+class ConsRanges : public Gecode::Propagator {
+protected:
+    // advisor of vars[i]
+    class RangeAdvisor : public Gecode::Advisor {
+    public:
+      int i;
+      RangeAdvisor(Gecode::Space& home, Gecode::Propagator& p,
+                   Gecode::Council<RangeAdvisor>& c, int i0)
+        : Advisor(home,p,c), i(i0) {}
+      RangeAdvisor(Gecode::Space& home, bool share, RangeAdvisor& a)
+        : Advisor(home,share,a), i(a.i) {}
+    };
+
+    // variables
+    Gecode::ViewArray<VA> vars;
+    VarRanges ranges;
+
+    Gecode::Council<RangeAdvisor> c;
+    int unassigned; // vars with an advisor
+
+public:
+    // posting
+    static Gecode::ExecStatus post(Gecode::Space& home,
+                                   Gecode::ViewArray<VA>& vars,
+                                   VarRanges& ranges
+                                  ) {
+      std::vector< std::pair<int,int> >& mima = ranges.mima();
+      bool all_assigned = true;
+      for (int i=0; i!=vars.size(); i++) {
+        mima[i].first = vars[i].min();
+        mima[i].second = vars[i].max();
+        if (!vars[i].assigned())
+          all_assigned = false;
+      }
+      if (!all_assigned)
+        (void) new (home) ConsRanges<VA>(home,vars,ranges);
+      return Gecode::ES_OK;
+    }
+
+    // post constructor
+    ConsRanges(Gecode::Space& home,
+               Gecode::ViewArray<VA>& vars0,
+               VarRanges& ranges0
+              )
+    : Propagator(home), vars(vars0), ranges(ranges0), c(home), unassigned(0)
+    {
+      for (int i=0; i!=vars.size(); i++)
+        if (!vars[i].assigned()) {
+          vars[i].subscribe(home,*new (home) RangeAdvisor(home,*this,c,i));
+          unassigned++;
+        }
+    }
+
+    // copy constructor
+    ConsRanges(Gecode::Space& home, bool share, ConsRanges& p)
+    : Propagator(home,share,p), unassigned(p.unassigned)
+    {
+      vars.update(home,share,p.vars);
+      ranges.update(home,share,p.ranges);
+      c.update(home,share,p.c);
+    }
+
+    virtual size_t dispose(Gecode::Space& home)
+    {
+      for (Gecode::Advisors<RangeAdvisor> as(c); as(); ++as)
+        vars[as.advisor().i].cancel(home,as.advisor());
+      c.dispose(home);
+      (void) Propagator::dispose(home);
+      return sizeof(*this);
+    }
+
+    virtual Gecode::Propagator* copy(Gecode::Space& home, bool share)
+    {
+      return new (home) ConsRanges<VA>(home,share,*this);
+    }
+
+    virtual Gecode::PropCost cost(const Gecode::Space&, const Gecode::ModEventDelta&) const
+    {
+      // the advisors do the work
+      return Gecode::PropCost::unary(Gecode::PropCost::LO);
+    }
+
+    // one var changed
+    virtual Gecode::ExecStatus advise(Gecode::Space& home, Gecode::Advisor& a, const Gecode::Delta& d);
+
+    // propagation
+    virtual Gecode::ExecStatus propagate(Gecode::Space& home, const Gecode::ModEventDelta&);
+
+};
+
+#endif
@@ -0,0 +1,308 @@
+#ifndef DENSE_SIMPLEX_HPP
+#define DENSE_SIMPLEX_HPP
+
+#include <vector>
+#include <limits>
+#include <cmath>
+
+using std::vector;
+
+// Small dense LP, solved with a tableau simplex:
+//   max  obj.x  s.t.  rows: a.x <= rhs,  lo <= x <= up  (all bounds finite)
+//
+// Meant for the few dozen variables of a relaxation at a search node, so no
+// sparsity and no factorisation. Variables with lo == up are substituted out.
+// The final basis is kept; if the next LP has the same free variables and
+// rows (e.g. a sibling node), solving starts from that basis when it is still
+// primal feasible, which typically leaves only a few pivots.
+// All storage is reused between solves.
+class DenseLP {
+ public:
+  enum Status { OPTIMAL, INFEASIBLE, UNBOUNDED, ITERLIMIT };
+
+  DenseLP() : solves(0), warm_starts(0), pivots(0), nr_vars(0), nr_rows(0), last_rows(-1) {}
+
+  // start a new LP over n variables, objective 0, bounds [0,0], no rows
+  void reset(int n);
+  void set_bounds(int j, double l, double u) { lo[j] = l; up[j] = u; }
+  void set_obj(int j, double c) { obj[j] = c; }
+  // new row 'coefs.x <= rhs', coefficients 0 until set with coef()
+  int add_row(double rhs);
+  double& coef(int i, int j) { return A[i*nr_vars + j]; }
+  Status solve(double& value);
+
+  size_t solves;
+  size_t warm_starts;
+  size_t pivots;
+
+ private:
+  int nr_vars;
+  int nr_rows;
+  vector<double> obj, lo, up, A, rhs;
+
+  // tableau over the free variables: m rows (the rows, then one per free
+  // variable for its upper bound), columns: free vars, slacks, artificials, rhs
+  vector<int> free_vars; // the LP variable of each structural column
+  int m, ncols, nart;
+  vector<double> T; // m+1 rows, the last one holds the reduced costs
+  vector<int> basis; // basic column of each row
+  vector<int> last_free, last_basis; // for warm starts
+  int last_rows;
+  vector<double> shifted, costs; // workspaces
+  vector<bool> in_last;
+
+  double& t(int i, int j) { return T[i*(ncols+1) + j]; }
+  void _build(bool artificials);
+  void _pivot(int r, int e);
+  void _set_obj(const vector<double>& c);
+  bool _iterate(int nr_enter, size_t max_iter, bool& unbounded);
+  bool _warm();
+};
+
+inline
+void DenseLP::reset(int n)
+{
+  nr_vars = n;
+  nr_rows = 0;
+  obj.assign(n, 0);
+  lo.assign(n, 0);
+  up.assign(n, 0);
+  A.clear();
+  rhs.clear();
+}
+
+inline
+int DenseLP::add_row(double b)
+{
+  A.resize(A.size() + nr_vars, 0);
+  rhs.push_back(b);
+  return nr_rows++;
+}
+
+// tableau for the substituted LP x = lo + x', 0 <= x' <= up-lo,
+// with the slack basis; rows with a negative rhs get an artificial if asked
+inline
+void DenseLP::_build(bool artificials)
+{
+  free_vars.clear();
+  for (int j=0; j!=nr_vars; j++)
+    if (up[j] > lo[j])
+      free_vars.push_back(j);
+  int nf = free_vars.size();
+  m = nr_rows + nf;
+
+  // right hand sides after substitution
+  vector<double>& b = shifted; // reused
+  b.resize(m);
+  for (int i=0; i!=nr_rows; i++) {
+    double v = rhs[i];
+    for (int j=0; j!=nr_vars; j++)
+      v -= A[i*nr_vars + j] * lo[j];
+    b[i] = v;
+  }
+  for (int k=0; k!=nf; k++)
+    b[nr_rows+k] = up[free_vars[k]] - lo[free_vars[k]];
+  nart = 0;
+  if (artificials)
+    for (int i=0; i!=m; i++)
+      if (b[i] < 0)
+        nart++;
+  ncols = nf + m + nart;
+
+  T.assign((m+1)*(ncols+1), 0);
+  basis.resize(m);
+  int art = nf + m;
+  for (int i=0; i!=m; i++) {
+    if (i < nr_rows) {
+      for (int k=0; k!=nf; k++)
+        t(i,k) = A[i*nr_vars + free_vars[k]];
+    } else {
+      t(i,i-nr_rows) = 1;
+    }
+    t(i,nf+i) = 1; // slack
+    t(i,ncols) = b[i];
+    basis[i] = nf+i;
+    if (artificials && b[i] < 0) {
+      for (int j=0; j!=ncols+1; j++)
+        t(i,j) = -t(i,j);
+      t(i,art) = 1;
+      basis[i] = art++;
+    }
+  }
+}
+
+inline
+void DenseLP::_pivot(int r, int e)
+{
+  pivots++;
+  int w = ncols+1;
+  double* row = &T[r*w];
+  double p = row[e];
+  for (int j=0; j!=w; j++)
+    row[j] /= p;
+  row[e] = 1;
+  for (int i=0; i!=m+1; i++) {
+    if (i == r)
+      continue;
+    double* other = &T[i*w];
+    double f = other[e];
+    if (f == 0)
+      continue;
+    for (int j=0; j!=w; j++)
+      other[j] -= f*row[j];
+    other[e] = 0;
+  }
+  basis[r] = e;
+}
+
+// reduced costs for the column costs c, given the current basis
+inline
+void DenseLP::_set_obj(const vector<double>& c)
+{
+  double* z = &T[m*(ncols+1)];
+  for (int j=0; j!=ncols+1; j++)
+    z[j] = (j < ncols ? c[j] : 0);
+  for (int i=0; i!=m; i++) {
+    double cb = c[basis[i]];
+    if (cb == 0)
+      continue;
+    for (int j=0; j!=ncols+1; j++)
+      z[j] -= cb*t(i,j);
+  }
+}
+
+// primal simplex on the first nr_enter columns, Bland's rule (no cycling);
+// the objective value is -z[rhs]
+inline
+bool DenseLP::_iterate(int nr_enter, size_t max_iter, bool& unbounded)
+{
+  const double eps = 1e-9;
+  unbounded = false;
+  double* z = &T[m*(ncols+1)];
+  for (size_t it=0; it!=max_iter; it++) {
+    int e = -1;
+    for (int j=0; j!=nr_enter; j++)
+      if (z[j] > eps) {
+        e = j;
+        break;
+      }
+    if (e == -1)
+      return true;
+    int r = -1;
+    double best = 0;
+    for (int i=0; i!=m; i++) {
+      double a = t(i,e);
+      if (a <= eps)
+        continue;
+      double ratio = t(i,ncols) / a;
+      if (r == -1 || ratio < best - eps || (ratio <= best + eps && basis[i] < basis[r])) {
+        r = i;
+        best = ratio;
+      }
+    }
+    if (r == -1) {
+      unbounded = true;
+      return true;
+    }
+    _pivot(r, e);
+  }
+  return false;
+}
+
+// bring the previous basis back in, true if it is primal feasible
+inline
+bool DenseLP::_warm()
+{
+  int nf = free_vars.size();
+  if (last_rows != nr_rows || last_free != free_vars)
+    return false;
+  in_last.assign(ncols, false);
+  for (int i=0; i!=m; i++) {
+    if (last_basis[i] >= nf+m) // an artificial was left in
+      return false;
+    in_last[last_basis[i]] = true;
+  }
+  for (int i=0; i!=m; i++) {
+    int e = last_basis[i];
+    bool basic = false;
+    for (int k=0; k!=m && !basic; k++)
+      basic = (basis[k] == e);
+    if (basic)
+      continue;
+    // replace a basic column that is not in the old basis, largest pivot
+    int r = -1;
+    for (int k=0; k!=m; k++)
+      if (!in_last[basis[k]] && std::fabs(t(k,e)) > 1e-7 &&
+          (r == -1 || std::fabs(t(k,e)) > std::fabs(t(r,e))))
+        r = k;
+    if (r == -1)
+      return false;
+    _pivot(r, e);
+  }
+  for (int i=0; i!=m; i++)
+    if (t(i,ncols) < -1e-9)
+      return false;
+  return true;
+}
+
+inline
+DenseLP::Status DenseLP::solve(double& value)
+{
+  solves++;
+  const size_t max_iter = 50*(nr_vars + nr_rows + 1);
+  bool unbounded = false;
+
+  // constant part of the objective
+  double base = 0;
+  for (int j=0; j!=nr_vars; j++)
+    base += obj[j]*lo[j];
+
+  _build(false);
+  int nf = free_vars.size();
+  if (!last_basis.empty() && _warm()) {
+    warm_starts++;
+  } else {
+    _build(true);
+  }
+  if (nart != 0) {
+    // phase 1: maximise -(sum of the artificials)
+    costs.assign(ncols, 0);
+    for (int j=nf+m; j!=ncols; j++)
+      costs[j] = -1;
+    _set_obj(costs);
+    if (!_iterate(ncols, max_iter, unbounded))
+      return ITERLIMIT;
+    if (T[m*(ncols+1) + ncols] > 1e-7) // -z > 0: some artificial stays positive
+      return INFEASIBLE;
+    // drive remaining (zero) artificials out of the basis
+    for (int i=0; i!=m; i++) {
+      if (basis[i] < nf+m)
+        continue;
+      for (int j=0; j!=nf+m; j++)
+        if (std::fabs(t(i,j)) > 1e-7) {
+          _pivot(i, j);
+          break;
+        }
+    }
+  }
+
+  // phase 2, artificials may not enter
+  costs.assign(ncols, 0);
+  for (int k=0; k!=nf; k++)
+    costs[k] = obj[free_vars[k]];
+  _set_obj(costs);
+  if (!_iterate(nf+m, max_iter, unbounded))
+    return ITERLIMIT;
+  if (unbounded) {
+    value = std::numeric_limits<double>::infinity();
+    return UNBOUNDED;
+  }
+  value = base - T[m*(ncols+1) + ncols];
+
+  last_free = free_vars;
+  last_rows = nr_rows;
+  last_basis = basis;
+  return OPTIMAL;
+}
+
+#endif //DENSE_SIMPLEX_HPP
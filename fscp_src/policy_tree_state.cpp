@@ -5,6 +5,43 @@ using namespace std;
 using namespace Gecode;
 
 
+PolTreeState::~PolTreeState()
+{
+  delete adaptive;
+  delete telemetry;
+  delete policy;
+  delete bound_pool; // joins the threads
+  for (size_t i=0; i!=bound_workers.size(); i++) {
+    delete bound_workers[i];
+    delete bound_workspaces[i];
+  }
+}
+
+// lazily, the utility and BN data are only known once the model is built
+bool PolTreeState::_start_bound_pool()
+{
+  if (bound_pool != NULL)
+    return true;
+  if (bn.is_dense()) {
+    // the lookups are cheaper than the hand-off
+    bound_threads = 1;
+    return false;
+  }
+  for (size_t i=0; i!=bound_threads; i++) {
+    AceEngine* ws = bn.new_workspace(); // own circuit and partials cache
+    PolTreeState* worker = new PolTreeState(*ws, 0);
+    worker->varBNid = varBNid;
+    worker->next_and = next_and;
+    worker->max_f = max_f;
+    bound_workspaces.push_back(ws);
+    bound_workers.push_back(worker);
+  }
+  bound_pool = new BoundPool(bound_threads);
+  if (verbose >= 1)
+    cout << "Started "<<bound_threads<<" bound threads\n";
+  return true;
+}
+
 void PolTreeState::init_bndata(vector< int >& varBNid0)
 {
   if (verbose >= 5) {
@@ -17,46 +54,185 @@ void PolTreeState::init_bndata(vector< int >& varBNid0)
   size_t nr_vars = varBNid.size();
   varsmima.resize(nr_vars);
   
-  // initialize leaf_evidence
+  // initialize leaf_evidence and the index tables
+  vector<int> and_order;
+  size_t max_domain = 0;
+  and_positions.clear();
+  and_prefix.resize(nr_vars+1);
+  prev_and.resize(nr_vars);
+  prev_or.resize(nr_vars);
+  int last_and = -1;
+  int last_or = -1;
   for (size_t i=0; i!=nr_vars; i++) {
     int bn_id = varBNid[i];
-    if (bn_id != -1) // AND node
+    and_prefix[i] = and_positions.size();
+    prev_and[i] = last_and;
+    prev_or[i] = last_or;
+    if (bn_id != -1) { // AND node
       leaf_evidence.push_back( make_pair(bn_id, -1) );
+      and_order.push_back(bn_id);
+      and_positions.push_back(i);
+      max_domain = max(max_domain, bn.domain_size(bn_id));
+      last_and = i;
+    } else {
+      last_or = i;
+    }
   }
+  and_prefix[nr_vars] = and_positions.size();
+  next_and.resize(nr_vars+1);
+  next_or.resize(nr_vars+1);
+  next_and[nr_vars] = nr_vars;
+  next_or[nr_vars] = nr_vars;
+  for (size_t i=nr_vars; i--;) {
+    next_and[i] = (varBNid[i] != -1 ? i : next_and[i+1]);
+    next_or[i] = (varBNid[i] == -1 ? i : next_or[i+1]);
+  }
+  // reserve all workspaces once, the search itself should not allocate
+  size_t nr_ands = and_order.size();
+  bound_evidence.reserve(nr_ands+1);
+  // the longest key: pos, depth_limit, util, and both parts with their sizes
+  bound_cache.init(bound_cache_mb << 20, 3 + 1 + 2*nr_vars + 1 + 2*(nr_ands+1));
+  if (bound_key_from.size() != nr_vars+1)
+    bound_key_from.assign(nr_vars+1, 0); // all ranges, until set_util()
+  bound_par_levels.reserve(nr_ands+1);
+  bound_par_sizes.reserve(nr_ands+1);
+  leaf_partials.reserve(max_domain);
+  dfs_pos.reserve(nr_ands);
+  dfs_idx.reserve(nr_ands);
+  dfs_sizem1.reserve(nr_ands);
+  choice_scores.reserve(max_domain);
+  choice_evidence.reserve(nr_ands);
+  
+  // small network? then precompute all probabilities we will ever need
+  bn.init_dense(and_order);
   
   // valuation of the exputil for each variable/depth
   evals.resize(nr_vars); // will be initialised in brancher
   lb.resize(nr_vars, min_inf);
   brch_rand_val.resize(nr_vars, -1); // will only be used for rand vars (varBnid[i] != -1)
   brch_rand_lastval.resize(nr_vars, false); // will only be used for rand vars (varBnid[i] != -1)
+  brch_commit_pos = -1;
+  
+  if (adaptive != NULL)
+    adaptive->init(varBNid);
+  if (telemetry != NULL)
+    telemetry->init(varBNid);
+  if (policy != NULL)
+    policy->init(varBNid);
+  if (context_on) {
+    OpenContext none;
+    none.open = false;
+    context_open.assign(nr_vars, none);
+    _context_bn_init();
+  }
 }
 
-
-double PolTreeState::bound_or(const ViewArray< Int::IntView >& vars, int pos, int depth_limit)
+// The later AND nodes F of an OR node are independent of the evidence E that
+// is not in its BN context given the evidence that is: the context is the
+// evidence that a path from F reaches first, in the moral graph of the
+// ancestors of F and E (so it separates F from the rest of E).
+void PolTreeState::_context_bn_init()
 {
-  // init the input for the prob and the input for the utility
-  int and_size = 0;
-  int and_pos = 0;
-  for (int i=0; i!=vars.size(); i++) {
-    varsmima[i].first = vars[i].min();
-    varsmima[i].second = vars[i].max();
-    if (varBNid[i] != -1) {
-      and_size += 1;
-      if (i < pos) // assigned AND node
-        and_pos++;
+  size_t nr_vars = varBNid.size();
+  size_t nr_ands = and_positions.size();
+  context_bn.assign(nr_vars, vector<int>());
+  if (bn_parents.empty()) {
+    for (size_t pos=0; pos!=nr_vars; pos++)
+      for (int s=0; s!=and_prefix[pos]; s++)
+        context_bn[pos].push_back(s);
+    return;
+  }
+  
+  size_t nr_bn = bn_parents.size();
+  vector<int> and_of(nr_bn, -1); // BN id to index in and_positions
+  for (size_t s=0; s!=nr_ands; s++)
+    and_of[varBNid[and_positions[s]]] = s;
+  // ancestors of all AND nodes, for every position
+  vector<bool> in_an(nr_bn, false);
+  vector<int> stack;
+  for (size_t s=0; s!=nr_ands; s++)
+    stack.push_back(varBNid[and_positions[s]]);
+  while (!stack.empty()) {
+    int v = stack.back();
+    stack.pop_back();
+    if (in_an[v])
+      continue;
+    in_an[v] = true;
+    for (size_t j=0; j!=bn_parents[v].size(); j++)
+      stack.push_back(bn_parents[v][j]);
+  }
+  // moral graph of the ancestors
+  vector< vector<int> > moral(nr_bn);
+  for (size_t v=0; v!=nr_bn; v++) {
+    if (!in_an[v])
+      continue;
+    const vector<int>& par = bn_parents[v];
+    for (size_t j=0; j!=par.size(); j++) {
+      moral[v].push_back(par[j]);
+      moral[par[j]].push_back(v);
+      for (size_t k=j+1; k!=par.size(); k++) {
+        moral[par[j]].push_back(par[k]);
+        moral[par[k]].push_back(par[j]);
+      }
     }
   }
-  // some nerdy code to do 'one shot' memory allocation
-  vector< pair<int,int> > evidence;
-  evidence.reserve(and_size);
-  evidence.resize(and_pos);
-  int s = 0;
-  for (int i=0; i!=pos; i++) {
-    if (varBNid[i] != -1) {
-      evidence[s].first = varBNid[i];
-      evidence[s].second = vars[i].val();
-      s++;
+  
+  vector<bool> seen(nr_bn);
+  for (size_t pos=0; pos!=nr_vars; pos++) {
+    if (varBNid[pos] != -1)
+      continue; // only looked up at OR nodes
+    int and_pos = and_prefix[pos];
+    seen.assign(nr_bn, false);
+    stack.clear();
+    for (size_t s=and_pos; s!=nr_ands; s++)
+      stack.push_back(varBNid[and_positions[s]]);
+    while (!stack.empty()) {
+      int v = stack.back();
+      stack.pop_back();
+      if (seen[v])
+        continue;
+      seen[v] = true;
+      if (and_of[v] != -1 && and_of[v] < and_pos)
+        continue; // evidence: in the context, the path stops here
+      for (size_t j=0; j!=moral[v].size(); j++)
+        stack.push_back(moral[v][j]);
     }
+    for (int s=0; s!=and_pos; s++)
+      if (seen[varBNid[and_positions[s]]])
+        context_bn[pos].push_back(s);
+  }
+}
+
+
+double PolTreeState::bound_or(vector< pair<int,int> >& varsmima, int pos, int depth_limit)
+{
+  return _bound_or(varsmima, pos, depth_limit);
+}
+
+// bound on the exputil of the child vars[pos]=val of OR node pos, with
+// vars[pos] not yet assigned (the bounds of the children of the root)
+double PolTreeState::bound_or_child(vector< pair<int,int> >& varsmima, int pos, int val, int depth_limit)
+{
+  pair<int,int> mima = varsmima[pos];
+  varsmima[pos].first = val;
+  varsmima[pos].second = val;
+  double v = _bound_or(varsmima, pos, depth_limit);
+  varsmima[pos] = mima;
+  return v;
+}
+
+// bound_or() for the ranges in varsmima
+double PolTreeState::_bound_or(vector< pair<int,int> >& varsmima, int pos, int depth_limit)
+{
+  int and_size = and_prefix[varsmima.size()];
+  int and_pos = and_prefix[pos]; // assigned AND nodes
+  // reserved in init_bndata(), so no memory allocation
+  vector< pair<int,int> >& evidence = bound_evidence;
+  evidence.resize(and_pos);
+  for (int s=0; s!=and_pos; s++) {
+    int i = and_positions[s];
+    evidence[s].first = varBNid[i];
+    evidence[s].second = varsmima[i].first;
   }
   depth_limit = min(depth_limit, and_size-and_pos);
   
@@ -83,31 +259,88 @@ double PolTreeState::bound_or(const ViewArray< Int::IntView >& vars, int pos, in
     
   } else { // depth_limit bound
     
-    return _bound_dfs(varsmima, evidence, pos, depth_limit);
+    return (this->*bound_dfs_fn)(varsmima, evidence, pos, depth_limit);
     //return _bound_dfs_loop(varsmima, evidence, pos, depth_limit, vars); // slower
   }
 }
 
+// upper bound on the utility of any scenario within the ranges,
+// min_inf if there is none (the relaxation is infeasible)
+double PolTreeState::_lp_value(vector< pair<int,int> >& varsmima)
+{
+  if (!lp_f(varsmima, lp))
+    return std::numeric_limits<double>::infinity();
+  double v;
+  switch (lp.solve(v)) {
+    case DenseLP::OPTIMAL:
+      return floor(v + 1e-6); // the utility is integral
+    case DenseLP::INFEASIBLE:
+      lp_infeasible++;
+      return min_inf;
+    default:
+      return std::numeric_limits<double>::infinity();
+  }
+}
+
+// bound on the exputil of OR node pos, with vars[pos] assigned
+double PolTreeState::bound_lp(vector< pair<int,int> >& varsmima, int pos)
+{
+  lp_calls++;
+  int and_pos = and_prefix[pos];
+  vector< pair<int,int> >& evidence = bound_evidence;
+  evidence.resize(and_pos);
+  for (int s=0; s!=and_pos; s++) {
+    int i = and_positions[s];
+    evidence[s].first = varBNid[i];
+    evidence[s].second = varsmima[i].first;
+  }
+  
+  int next = next_and[pos+1];
+  if (lp_bound < 2 || next == (int)varsmima.size()) {
+    double prob = bn.pr(evidence);
+    if (prob == 0)
+      return 0;
+    double util = _lp_value(varsmima);
+    if (verbose >= 3)
+      cout << "LP bound: "<<util*prob<<" ( "<<util<<" * "<<prob<<" )\n";
+    return util*prob;
+  }
+  
+  // expectation over the values of the next AND node
+  pair<int,int> mima = varsmima[next];
+  bn.var_partials(evidence, varBNid[next], leaf_partials);
+  double v = 0;
+  for (size_t i=0; i!=leaf_partials.size(); i++) {
+    double prob = leaf_partials[i].second;
+    if (prob == 0)
+      continue;
+    varsmima[next].first = leaf_partials[i].first;
+    varsmima[next].second = leaf_partials[i].first;
+    double util = _lp_value(varsmima);
+    if (util == min_inf) { // no feasible scenario for this value, so none for the node
+      v = min_inf;
+      break;
+    }
+    v += util*prob;
+  }
+  varsmima[next] = mima;
+  if (verbose >= 3)
+    cout << "LP bound (next AND "<<next<<"): "<<v<<"\n";
+  return v;
+}
+
 // vals is <val,prob> vector
 // we replace it with a <val,exputil_ub> vector
 void
-PolTreeState::bounds_and(const ViewArray< Int::IntView >& vars,
+PolTreeState::bounds_and(vector< pair<int,int> >& varsmima,
                          int pos,
                          vector< pair< int, double > >& return_vals,
                          int depth_limit
                         )
 {
-  // init the input for the utility
-  int and_size = 0;
-  int evd_size = 0;
-  for (int i=0; i!=vars.size(); i++) {
-    varsmima[i].first = vars[i].min();
-    varsmima[i].second = vars[i].max();
-    if (varBNid[i] != -1) {
-      and_size += 1;
-      evd_size += (i < pos);
-    }
-  }
+  pair<int,int> mima = varsmima[pos]; // restored before returning
+  int and_size = and_prefix[varsmima.size()];
+  int evd_size = and_prefix[pos];
   depth_limit = min(depth_limit, and_size-evd_size);
   
   if (verbose >= 4) {
@@ -120,22 +353,14 @@ PolTreeState::bounds_and(const ViewArray< Int::IntView >& vars,
   
   // replace return_vals' second from prob to ub on exputil
   if (depth_limit <= 1) {
-    for (size_t i=0; i!=return_vals.size(); i++) {
-      int val = return_vals[i].first;
-      double prob = return_vals[i].second;
-      varsmima[pos].first = val; varsmima[pos].second = val;
-      int util = max_f(varsmima);
-      if (verbose >= 5)
-        cout << "vars["<<pos<<"]="<<val<<": util*prob = "<<util*prob<<" = "<<util<<" * "<<prob<<"\n";
-    
-      return_vals[i].second = util*prob;
-    }
+    (this->*bound_leaves_fn)(varsmima, pos, return_vals);
   } else {
     // do DFS to depth_limit (>1)
-    vector< pair<int,int> > evidence;
-    for (int i=0; i!=pos; i++) {
-      if (varBNid[i] != -1)
-        evidence.push_back( make_pair(varBNid[i], varsmima[i].first) ); // guaranteed assigned
+    vector< pair<int,int> >& evidence = bound_evidence;
+    evidence.clear();
+    for (int s=0; s!=evd_size; s++) {
+      int i = and_positions[s];
+      evidence.push_back( make_pair(varBNid[i], varsmima[i].first) ); // guaranteed assigned
     }
     size_t s = evidence.size();
     evidence.push_back( make_pair(varBNid[pos], -1) ); // random value, will be overwritten
@@ -143,58 +368,46 @@ PolTreeState::bounds_and(const ViewArray< Int::IntView >& vars,
       int val = return_vals[i].first;
       varsmima[pos].first = val; varsmima[pos].second = val;
       evidence[s].second = val;
-      return_vals[i].second = _bound_dfs(varsmima, evidence, pos+1, depth_limit-1);
+      return_vals[i].second = (this->*bound_dfs_fn)(varsmima, evidence, pos+1, depth_limit-1);
     }
   }
+  varsmima[pos] = mima;
 }
 
-double PolTreeState::_bound_dfs(vector< pair<int,int> >& varsmima,
-                                vector< pair<int,int> >& evidence,
-                                int pos,
-                                int depth_limit)
+// the key is rebuilt for the insert, the recursion in between built others
+bool PolTreeState::_bound_cache_find(const vector< pair< int, int > >& varsmima,
+                                     const vector< pair< int, int > >& evidence,
+                                     int pos,
+                                     int depth_limit,
+                                     int util,
+                                     double& v)
 {
-  while (varBNid[pos] == -1)
-    pos++;
-  if (verbose >= 4) {
-    cout << "_bound_dfs(vmm,ev,"<<pos<<","<<depth_limit<<")\n";
-    cout << "varsmima, depth="<<depth<<":";
-    for (size_t i=0; i!=varsmima.size(); i++)
-      cout << " " << varsmima[i].first << "," << varsmima[i].second;
-    cout << "\n";
-    cout << "evidence:";
-    for (size_t i=0; i!=evidence.size(); i++)
-      cout << " " << evidence[i].first << "," << evidence[i].second;
-    cout << "\n";
-  }
-  assert(depth_limit > 0);
-  
-  if (depth_limit == 1) {
-    double v = 0;
-    const vector< pair<int,double> >& probs = bn.var_partials(evidence, varBNid[pos]);
-    for (size_t i=0; i!=probs.size(); i++) {
-      int val = probs[i].first;
-      double prob = probs[i].second;
-      varsmima[pos].first = val; varsmima[pos].second = val;
-      int util = max_f(varsmima);
-      if (verbose >= 5)
-        cout << "Leaf! vars["<<pos<<"]="<<val<<": util*prob = "<<util*prob<<" = "<<util<<" * "<<prob<<"\n";
-      v += util*prob;
-    }
-    return v;
+  if (!bound_cache.enabled())
+    return false;
+  bound_cache.key_begin(pos, depth_limit, util);
+  bound_cache.key_add(varsmima, bound_key_from[pos]);
+  bound_cache.key_add(evidence, 0);
+  if (bound_cache.find(v)) {
+    bound_cache_hits++;
+    return true;
   }
-  
-  // else: dive down
-  double v = 0;
-  size_t s = evidence.size();
-  evidence.push_back( make_pair(varBNid[pos], -1) ); // random val, will be overwritten
-  const vector< vector<int> >* val_ids = bn.get_val_ids();
-  for (auto val : val_ids->at(varBNid[pos])) {
-    varsmima[pos].first = val; varsmima[pos].second = val;
-    evidence[s].second = val;
-    v += _bound_dfs(varsmima, evidence, pos+1, depth_limit-1);
-  }
-  evidence.pop_back();
-  return v;
+  bound_cache_misses++;
+  return false;
+}
+
+void PolTreeState::_bound_cache_insert(const vector< pair< int, int > >& varsmima,
+                                       const vector< pair< int, int > >& evidence,
+                                       int pos,
+                                       int depth_limit,
+                                       int util,
+                                       double v)
+{
+  if (!bound_cache.enabled())
+    return;
+  bound_cache.key_begin(pos, depth_limit, util);
+  bound_cache.key_add(varsmima, bound_key_from[pos]);
+  bound_cache.key_add(evidence, 0);
+  bound_cache.insert(v);
 }
 
 // same DFS bound, but using a loop instead of recursion
@@ -212,9 +425,9 @@ double PolTreeState::_bound_dfs_loop(vector< pair<int,int> >& varsmima,
   // dfs state, values will be set next
   int d = 0;
   evidence.resize(ev_size + depth_limit-1); // not last one, we use var_partials on that
-  vector<int> dfs_pos(depth_limit);
-  vector<int> dfs_idx(depth_limit, 0); // dfs_idx[d] = 0..dfs_size[d]-1
-  vector<int> dfs_sizem1(depth_limit); // difference offset 0 and offset 1
+  dfs_pos.resize(depth_limit);
+  dfs_idx.assign(depth_limit, 0); // dfs_idx[d] = 0..dfs_size[d]-1
+  dfs_sizem1.resize(depth_limit); // difference offset 0 and offset 1
   for (size_t i=pos; i!=varsmima.size(); i++) {
     int bn_id = varBNid[i];
     if (bn_id != -1) {
@@ -246,7 +459,8 @@ double PolTreeState::_bound_dfs_loop(vector< pair<int,int> >& varsmima,
     if (d == depth_limit-1) { // d is offset 0, depth_limit is offset 1
       // get exputil of last layer
       int i = dfs_pos[d];
-      const vector< pair<int,double> >& probs = bn.var_partials(evidence, varBNid[i]);
+      bn.var_partials(evidence, varBNid[i], leaf_partials);
+      const vector< pair<int,double> >& probs = leaf_partials;
       for (size_t j=0; j!=probs.size(); j++) {
         int val = probs[j].first;
         double prob = probs[j].second;
@@ -286,29 +500,40 @@ void PolTreeState::new_leaf(const IntVarArray& vars, const IntVar& util)
 {
   // in leaf, compute upward
   assert(util.assigned());
+  if (nogoods_on)
+    nogood_resolve(false);
   int vars_size = vars.size();
   
   //* first, get evidence and get probability
   // current evidence; pair<int,int> = (varBNid, value)
-  int index=0;
-  for (int i=0; i!=vars_size; i++) {
-    int bn_id = varBNid[i];
-    if (bn_id != -1) // AND node
-      leaf_evidence[index++].second = vars[i].val();
-  }
+  for (size_t s=0; s!=and_positions.size(); s++)
+    leaf_evidence[s].second = vars[and_positions[s]].val();
   // get marginal probability of current state
   double prob = bn.pr(leaf_evidence);
   
   //* then, compute value over all OR nodes and also all AND nodes if assigned to last value
-  double child_val = prob*util.val(); // for OR nodes
-  double child_diff = child_val; // for AND nodes
-  int parent=vars_size-1;
+  double child_val = prob*util.val();
   if (verbose >= 2)
     cout << "In leaf! exputil="<<child_val<<" with prob "<<prob<<endl;
   if (verbose >= 8) {
     cout << "Util by CP: " << util.val() << " util by manual IA: " << this->max_f_vars(vars) << endl;
     assert(util.val() == this->max_f_vars(vars));
   }
+  if (policy != NULL)
+    policy->leaf(vars);
+  if (_backup(vars_size-1, child_val)) {
+    // got to parent, update exputil var
+    root_updates++;
+    if (verbose >= 0)
+      cout << "*** New root: " << vars[0] << " exputil: " << evals[0] << "\n";
+  } 
+}
+
+// back up the value of a completed child of 'parent' (a leaf, or a subtree
+// from the context cache), true if it got to the root
+bool PolTreeState::_backup(int parent, double child_val) // child_val for OR nodes
+{
+  double child_diff = child_val; // for AND nodes
   for (; parent >= 0; parent--) {
     int bn_id = varBNid[parent];
     if (bn_id == -1) { // OR node (max)
@@ -321,18 +546,18 @@ void PolTreeState::new_leaf(const IntVarArray& vars, const IntVar& util)
       if (verbose >= 2)
         cout << "updating OR["<<parent<<"] from "<<evals[parent]<<" to "<<child_val<<" (diff="<<child_diff<<")\n";
       evals[parent] = child_val;
+      if (policy != NULL)
+        policy->improved(parent);
         
     } else { // AND node (sum)
       // update 'evals' values up to a parent OR node
-      int x = parent;
-      while (x >= 0 && varBNid[x] != -1) {
+      for (int x = parent; x > prev_or[parent]; x--) {
         if (verbose >= 2)
           cout << "updating AND["<<x<<"] from "<<evals[x];
         evals[x] += child_diff;
         child_val = evals[x];
         if (verbose >= 2)
           cout <<" to "<<evals[x]<<" (diff="<<child_diff<<")\n";
-        x--;
       }
       
       //* AND node state maintance (up to parent OR node)
@@ -347,9 +572,7 @@ void PolTreeState::new_leaf(const IntVarArray& vars, const IntVar& util)
         }
         
         else { // is last val, reset the previous random variable's val (certifies non-failed AND child)
-          int prev=parent-1;
-          while (prev >= 0 && varBNid[prev] == -1)
-            prev--;
+          int prev = prev_and[parent];
           if (prev >= 0) { // found previous AND var
             if (verbose >= 2)
               cout << "Marking prev AND var: "<<prev<<" with bn_id "<<varBNid[prev]<<" as fully explored\n";
@@ -364,10 +587,293 @@ void PolTreeState::new_leaf(const IntVarArray& vars, const IntVar& util)
     }
     
   }
-  if (parent < 0) {
-    // got to parent, update exputil var
-    cout << "*** New root: " << vars[0] << " exputil: " << evals[0] << "\n";
-  } 
+  return (parent < 0);
+}
+
+// in choice() of the OR node at pos (not yet branched on): true if the
+// subtree is resolved from the context cache, its value is then backed up
+// (or it is infeasible or can not beat the lower bound) and it must not be
+// searched; otherwise the subtree is registered, to be stored when done
+bool PolTreeState::context_lookup(const vector< pair<int,int> >& varsmima, int pos)
+{
+  context_ctx.clear();
+  int past = 0;
+  if (!context_f(varsmima, pos, context_ctx, past))
+    return false;
+  
+  // key: position, model context, BN context
+  vector< pair<int,int> >& key = context_key;
+  key.clear();
+  key.push_back( make_pair(-1, pos) );
+  for (size_t i=0; i!=context_ctx.size(); i++)
+    key.push_back( make_pair(-1, context_ctx[i]) );
+  int and_pos = and_prefix[pos];
+  vector< pair<int,int> >& evidence = bound_evidence;
+  evidence.resize(and_pos);
+  for (int s=0; s!=and_pos; s++) {
+    int i = and_positions[s];
+    evidence[s].first = varBNid[i];
+    evidence[s].second = varsmima[i].first;
+  }
+  const vector<int>& bn_ctx = context_bn[pos];
+  for (size_t j=0; j!=bn_ctx.size(); j++)
+    key.push_back(evidence[bn_ctx[j]]);
+  double prob = bn.pr(evidence);
+  if (prob == 0)
+    return false;
+  
+  auto it = context_cache.find(key);
+  if (it != context_cache.end()) {
+    const ContextEntry& e = it->second;
+    if (e.exact) {
+      context_hits++;
+      if (e.value != min_inf && _backup(pos, (e.value + past)*prob)) {
+        root_updates++;
+        if (verbose >= 0)
+          cout << "*** New root: " << varsmima[0].first << " exputil: " << evals[0] << "\n";
+      }
+      return true;
+    }
+    if (lb[pos] != min_inf && !((e.value + past)*prob > lb[pos])) {
+      context_prunes++;
+      return true;
+    }
+  }
+  context_misses++;
+  OpenContext& o = context_open[pos];
+  o.open = true;
+  o.key = key;
+  o.prob = prob;
+  o.past = past;
+  o.lb = lb[pos];
+  return false;
+}
+
+// a commit at pos: the subtrees at pos and below are done, store them
+void PolTreeState::context_close(int pos)
+{
+  for (size_t i=pos; i!=context_open.size(); i++) {
+    OpenContext& o = context_open[i];
+    if (!o.open)
+      continue;
+    o.open = false;
+    // the value is only exact if it beats the lower bound (else the subtree may
+    // have been pruned, and the value is at most the lower bound)
+    ContextEntry e;
+    double v = evals[i];
+    if (v != min_inf && (o.lb == min_inf || v > o.lb)) {
+      e.exact = true;
+      e.value = v/o.prob - o.past;
+    } else if (o.lb == min_inf) {
+      e.exact = true; // nothing pruned, no feasible child
+      e.value = min_inf;
+    } else {
+      e.exact = false;
+      e.value = o.lb/o.prob - o.past;
+    }
+    if (context_cache.size() >= context_cache_size) {
+      context_cache.clear();
+      context_flushes++;
+    }
+    auto res = context_cache.emplace(o.key, e);
+    if (!res.second && !res.first->second.exact) // keep exact values, and the lowest upper bound
+      if (e.exact || e.value < res.first->second.value)
+        res.first->second = e;
+  }
+}
+
+// in commit of the OR node at pos, before vars[pos]=val: true if that
+// child is a nogood, otherwise it is kept to learn if it fails
+bool PolTreeState::nogood_check(const vector< pair<int,int> >& varsmima, int pos, int val)
+{
+  nogood_valid = false;
+  // start of the stage
+  int start = pos;
+  int past = 0;
+  context_ctx.clear();
+  while (start >= 0 && !context_f(varsmima, start, context_ctx, past))
+    start--;
+  if (start < 0)
+    return false;
+  
+  vector< pair<int,int> >& key = nogood_key;
+  key.clear();
+  key.push_back( make_pair(-1, pos) );
+  key.push_back( make_pair(-1, val) );
+  for (size_t i=0; i!=context_ctx.size(); i++)
+    key.push_back( make_pair(-1, context_ctx[i]) );
+  for (int i=start; i!=pos; i++)
+    key.push_back( make_pair(varBNid[i], varsmima[i].first) );
+  if (nogoods.count(key) != 0) {
+    nogood_hits++;
+    return true;
+  }
+  nogood_valid = true;
+  return false;
+}
+
+// the brancher's next call after an OR commit: learn if its child failed
+void PolTreeState::nogood_resolve(bool failed)
+{
+  nogood_valid = false; // a new commit or node
+  if (!nogood_armed)
+    return;
+  nogood_armed = false;
+  if (!failed)
+    return;
+  if (nogoods.size() >= nogood_store_size) {
+    nogoods.clear();
+    nogood_flushes++;
+  }
+  if (nogoods.insert(nogood_key).second)
+    nogood_learned++;
+}
+
+// the search starts with positions 0..k-1 already assigned (a subtree of the
+// full tree, see parallel_solve.h), so their choice() and commit() never run:
+// init them here such that new_leaf() backs the values up to the root,
+// evals[0] is then the value of the subtree; root_lb is a lower bound for
+// the OR node at position 0 (min_inf if none)
+void PolTreeState::start_subtree(int k, double root_lb)
+{
+  for (int i=0; i!=k; i++) {
+    if (varBNid[i] == -1) { // OR node
+      evals[i] = min_inf;
+      lb[i] = (i == 0 ? root_lb : lb[i-1]);
+    } else { // AND node, with a single child
+      evals[i] = 0;
+      lb[i] = min_inf;
+      brch_rand_val[i] = -1;
+      brch_rand_lastval[i] = true;
+    }
+  }
+}
+
+// upper bound on the value of the root: the incumbent, or a child of an OR
+// root that is not done yet
+double PolTreeState::root_upper_bound() const
+{
+  if (varBNid[0] != -1 || root_child_ub.empty())
+    return root_ub;
+  double ub = (root_updates != 0 ? evals[0] : min_inf);
+  for (size_t i=root_child; i<root_child_ub.size(); i++)
+    ub = max(ub, root_child_ub[i]);
+  return ub;
+}
+
+// the state of the policy tree, for a checkpoint of the search (see
+// andor_dfs.h); the caches and counters are not saved
+void PolTreeState::checkpoint_save(std::ostream& os) const
+{
+  ckp_put(os, depth);
+  ckp_put(os, evals);
+  ckp_put(os, lb);
+  ckp_put(os, brch_rand_val);
+  vector<char> lastval(brch_rand_lastval.begin(), brch_rand_lastval.end());
+  ckp_put(os, lastval);
+  ckp_put(os, root_updates);
+  ckp_put(os, root_ub);
+  ckp_put(os, (unsigned long int)root_child_ub.size());
+  for (size_t i=0; i!=root_child_ub.size(); i++)
+    ckp_put(os, root_child_ub[i]);
+  ckp_put(os, root_child);
+}
+
+bool PolTreeState::checkpoint_load(std::istream& is)
+{
+  vector<char> lastval(brch_rand_lastval.size());
+  unsigned long int n;
+  if (!ckp_get(is, depth) || !ckp_get(is, evals) || !ckp_get(is, lb) || !ckp_get(is, brch_rand_val) ||
+      !ckp_get(is, lastval) || !ckp_get(is, root_updates) || !ckp_get(is, root_ub) || !ckp_get(is, n))
+    return false;
+  root_child_ub.resize(n);
+  for (size_t i=0; i!=n; i++)
+    if (!ckp_get(is, root_child_ub[i]))
+      return false;
+  if (!ckp_get(is, root_child))
+    return false;
+  brch_rand_lastval.assign(lastval.begin(), lastval.end());
+  return true;
+}
+
+void PolTreeState::print_stats(std::ostream& os) const
+{
+  if (bound_cache.enabled()) {
+    size_t lookups = bound_cache_hits + bound_cache_misses;
+    os << "Bound cache:"
+       << " hits: " << bound_cache_hits
+       << " misses: " << bound_cache_misses
+       << " hitrate: " << (lookups == 0 ? 0.0 : (double)bound_cache_hits / lookups)
+       << " entries: " << bound_cache.entries()
+       << " flushes: " << bound_cache.flushes
+       << "\n";
+  }
+  if (replays != 0)
+    os << "Replayed commits: " << replays << "\n";
+  if (or_order_depth >= 0) {
+    os << "OR value order:"
+       << " depth: " << or_order_depth
+       << " nodes: " << or_order_nodes
+       << " bounds: " << or_order_bounds
+       << " time: " << or_order_time
+       << " prunes: " << or_order_prunes
+       << "\n";
+  }
+  if (context_on) {
+    os << "Context cache:"
+       << " hits: " << context_hits
+       << " prunes: " << context_prunes
+       << " misses: " << context_misses
+       << " entries: " << context_cache.size()
+       << " flushes: " << context_flushes
+       << "\n";
+  }
+  if (prop_depth >= 0) {
+    os << "ExpUtil propagator:"
+       << " depth: " << prop_depth
+       << " runs: " << prop_runs
+       << " bounds: " << prop_bounds
+       << " prunes: " << prop_prunes
+       << "\n";
+  }
+  if (nogoods_on) {
+    os << "Nogoods:"
+       << " learned: " << nogood_learned
+       << " hits: " << nogood_hits
+       << " stored: " << nogoods.size()
+       << " flushes: " << nogood_flushes
+       << "\n";
+  }
+  if (adaptive != NULL)
+    adaptive->print(os);
+  if (policy != NULL) {
+    if (policy->finish(root_updates != 0))
+      os << "Policy written to " << policy->filename << " (" << policy->records
+         << " decisions recorded, " << policy->moved << " bytes moved)\n";
+    else
+      os << "Policy could not be written to " << policy->filename << "\n";
+  }
+  if (telemetry != NULL) {
+    telemetry->close_from(0, evals); // the last children of the root
+    if (telemetry->write_csv())
+      os << "Bound telemetry written to " << telemetry->filename << "\n";
+  }
+  if (lp_bound != 0) {
+    os << "LP bound:"
+       << " calls: " << lp_calls
+       << " prunes: " << lp_prunes
+       << " infeasible: " << lp_infeasible
+       << " solves: " << lp.solves
+       << " warm starts: " << lp.warm_starts
+       << " pivots: " << lp.pivots
+       << "\n";
+  }
+  if (bound_pool != NULL) {
+    os << "Bound threads: " << bound_threads
+       << " parallel bounds: " << bound_par_calls
+       << " tasks: " << bound_par_tasks
+       << "\n";
+  }
 }
 
 double PolTreeState::max_f_vars(const IntVarArray& vars)
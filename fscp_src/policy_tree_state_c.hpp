@@ -4,25 +4,128 @@
 #include <string>
 #include <utility>
 #include <functional>
+#include <unordered_map>
+#include <unordered_set>
+#include <ostream>
+#include <cstdint>
 #include <gecode/int.hh>
 #include <ace_engine.hpp>
+#include "bound_pool.hpp"
+#include "bound_cache.hpp"
+#include "adaptive_depth.hpp"
+#include "bound_telemetry.hpp"
+#include "dense_simplex.hpp"
+#include "policy_writer.hpp"
+#include "checkpoint_io.hpp"
 
 using std::vector;
 using std::string;
 using std::pair;
 
+// type-erased utility, fallback when no functor type is given to set_util()
+typedef std::function<int(vector< pair<int,int> >&)> UtilFunction;
+
+// linear relaxation of the model over the variable ranges (see lp_relaxations.h),
+// fills the LP and returns true, or false if there is none for these ranges
+typedef std::function<bool(const vector< pair<int,int> >&, DenseLP&)> LPFunction;
+
+// context of the subproblem at position pos (see contexts.h): appends the
+// model state that the rest of the problem depends on to ctx and sets past
+// to the utility of the assigned part, such that the utility is past plus a
+// function of the context and the later variables; false if pos has none
+typedef std::function<bool(const vector< pair<int,int> >&, int, vector<int>&, int&)> ContextFunction;
+
+// A utility functor can optionally be decomposed: if it has a member
+//   int delta(const vector< pair<int,int> >& VS, int pos, const pair<int,int>& old) const
+// returning the change of the bound when VS[pos] changed from 'old' to its
+// current range, the bound DFS maintains the bound incrementally in O(1)
+// instead of re-evaluating all stages at every leaf. It then also has
+//   int reads_from(int pos) const
+// the lowest position that delta() reads for pos, so that a bound cached
+// at pos only has to be keyed on the ranges from there on.
+template<class F>
+class util_has_delta {
+  template<class G> static char test(decltype(&G::delta));
+  template<class G> static long test(...);
+ public:
+  static const bool value = (sizeof(test<F>(0)) == sizeof(char));
+};
+
+template<class F, bool incremental = util_has_delta<F>::value>
+struct UtilUpdate {
+  // bound after VS[pos] changed from 'old', given the bound 'util' before
+  static int apply(const F& f, vector< pair<int,int> >& VS, int pos, const pair<int,int>& old, int util) {
+    return f(VS); // not decomposed, recompute
+  }
+  // from[pos]: the first position the bounds below pos depend on
+  static void key_from(const F& f, vector<int>& from) {
+    from.assign(from.size(), 0); // all of them
+  }
+};
+template<class F>
+struct UtilUpdate<F, true> {
+  static int apply(const F& f, vector< pair<int,int> >& VS, int pos, const pair<int,int>& old, int util) {
+    return util + f.delta(VS, pos, old);
+  }
+  static void key_from(const F& f, vector<int>& from) {
+    if (from.empty())
+      return;
+    from.back() = from.size()-1;
+    for (size_t i=from.size()-1; i--;)
+      from[i] = std::min(f.reads_from(i), from[i+1]);
+  }
+};
+
 class PolTreeState {
  public:
   PolTreeState (AceEngine& _bn,
 		int verbose0=0)
-  : verbose(verbose0), depth(0), bn(_bn){}
-  ~PolTreeState() {}
+  : verbose(verbose0), depth(0), bn(_bn), root_updates(0), replays(0),
+    root_bounds(false), root_ub(std::numeric_limits<double>::infinity()), root_child(0),
+    bound_cache_mb(0), bound_cache_hits(0), bound_cache_misses(0),
+    bound_threads(1), bound_par_calls(0), bound_par_tasks(0), adaptive(NULL), telemetry(NULL), policy(NULL),
+    lp_bound(0), lp_calls(0), lp_prunes(0), lp_infeasible(0),
+    or_order_depth(-1), or_order_nodes(0), or_order_bounds(0), or_order_time(0), or_order_prunes(0),
+    context_on(false), context_hits(0), context_prunes(0), context_misses(0), context_flushes(0),
+    nogoods_on(false), nogood_hits(0), nogood_learned(0), nogood_flushes(0),
+    prop_depth(-1), prop_runs(0), prop_bounds(0), prop_prunes(0),
+    bound_pool(NULL), nogood_valid(false), nogood_armed(false),
+    bound_dfs_fn(&PolTreeState::_bound_dfs_entry<UtilFunction>),
+    bound_leaves_fn(&PolTreeState::_bound_leaves_entry<UtilFunction>) {}
+  ~PolTreeState();
+  
+  // set the utility as a functor of type F, the bound kernels are then
+  // instantiated for F so that the utility can be inlined in the leaf loops
+  // (assigning max_f directly also works, but calls through std::function)
+  template<class F>
+  void set_util(const F& f) {
+    max_f = f;
+    bound_dfs_fn = &PolTreeState::_bound_dfs_entry<F>;
+    bound_leaves_fn = &PolTreeState::_bound_leaves_entry<F>;
+    UtilUpdate<F>::key_from(f, bound_key_from);
+  }
   
   void init_bndata(vector<int>& varBNid);
-  double bound_or(const Gecode::ViewArray<Gecode::Int::IntView>& vars, int pos, int depth_limit);
-  void bounds_and(const Gecode::ViewArray<Gecode::Int::IntView>& vars, int pos, vector< std::pair<int,double> >& vals, int depth_limit);
+  void _context_bn_init();
+  // the bound routines take the ranges of the space (see VarRanges), they
+  // may change them while they run but leave them as they were
+  double bound_or(vector< std::pair<int,int> >& varsmima, int pos, int depth_limit);
+  double bound_or_child(vector< std::pair<int,int> >& varsmima, int pos, int val, int depth_limit);
+  void bounds_and(vector< std::pair<int,int> >& varsmima, int pos, vector< std::pair<int,double> >& vals, int depth_limit);
+  double bound_lp(vector< std::pair<int,int> >& varsmima, int pos);
   void new_leaf(const Gecode::IntVarArray& vars, const Gecode::IntVar& util);
+  void start_subtree(int k, double root_lb);
+  bool context_lookup(const vector< std::pair<int,int> >& varsmima, int pos);
+  void context_close(int pos);
+  bool nogood_check(const vector< std::pair<int,int> >& varsmima, int pos, int val);
+  void nogood_arm() { nogood_armed = nogood_valid; }
+  void nogood_disarm() { nogood_armed = false; }
+  void nogood_resolve(bool failed);
   double max_f_vars(const Gecode::IntVarArray& vars);
+  double root_upper_bound() const;
+  void print_stats(std::ostream& os) const;
+  void checkpoint_save(std::ostream& os) const;
+  bool checkpoint_load(std::istream& is);
   
  public:
   double min_inf = -std::numeric_limits<double>::max();
@@ -36,17 +139,371 @@ class PolTreeState {
   AceEngine& bn;
   std::vector<int> varBNid; // set with init_bndata()
   
+  // index tables, set with init_bndata(), so that no code has to walk varBNid
+  vector<int> and_positions; // positions of the AND nodes, in order
+  vector<int> and_prefix; // number of AND nodes before position i (nr_vars+1 entries)
+  vector<int> next_and; // first AND position >= i, or nr_vars (nr_vars+1 entries)
+  vector<int> prev_and; // last AND position < i, or -1
+  vector<int> next_or; // first OR position >= i, or nr_vars (nr_vars+1 entries)
+  vector<int> prev_or; // last OR position < i, or -1
+  
   // for random variables (detect failure)
   vector<int> brch_rand_val; // which value the brancher chose for this rand var, -1=none
   vector<bool> brch_rand_lastval; // this value is the last value to try for this var
+  int brch_commit_pos; // position the brancher is assigning right now, -1=none
+  size_t root_updates; // number of times new_leaf() got to the root (so the tree is feasible)
+  size_t replays; // commits replayed by recomputation, counted by the brancher
+  
+  // for the anytime search (see search_monitor.h): upper bounds on the root,
+  // computed by the brancher in its first choice, and the root child under way
+  bool root_bounds; // compute them
+  double root_ub; // of the whole root, infinity until computed
+  vector<double> root_child_ub; // of the children of an OR root, in choice order
+  int root_child;
   
   // for the utility
-  std::function<int(vector< pair<int,int> >&)> max_f; // function, must be set in CP model!
+  UtilFunction max_f; // function, must be set in CP model! (preferably with set_util())
+  
+  // bound cache (transposition table), allocated once in init_bndata() and
+  // flushed when full; keyed on the position, the evidence, the utility of
+  // the ranges and the ranges that the rest of the bound reads (bound_key_from)
+  size_t bound_cache_mb; // 0 = disabled
+  size_t bound_cache_hits;
+  size_t bound_cache_misses;
+  
+  // parallel bounds: the top levels of a deep enough bound DFS are split
+  // over bound_threads workers, each with its own circuit workspace
+  size_t bound_threads; // 1 = sequential
+  size_t bound_par_calls;
+  size_t bound_par_tasks;
+  static const int bound_par_min_depth = 3; // shallower bounds are not worth the hand-off
+  
+  // bound depth per position chosen online, NULL if the fixed depths are used
+  AdaptiveDepth* adaptive;
+  // per-level counters on the bounds, NULL if not requested
+  BoundTelemetry* telemetry;
+  // the optimal policy, written while searching, NULL if not requested
+  PolicyWriter* policy;
+  
+  // LP bound at OR nodes, in addition to bound_or(): the LP relaxation lp_f
+  // of the remaining stages times pr(evidence) (lp_bound=1), or the exact
+  // expectation over the next AND node of the LP with that node fixed (lp_bound=2)
+  int lp_bound; // 0 = disabled
+  LPFunction lp_f; // set in the CP model, if any
+  DenseLP lp;
+  size_t lp_calls;
+  size_t lp_prunes; // counted by the brancher
+  size_t lp_infeasible;
+  
+  // bound-guided value order at OR nodes (--branch_or 2 or 3): the brancher
+  // explores the children by decreasing bound_or() at depth or_order_depth,
+  // so that a good lower bound is found early; -1 if off. The bounds are
+  // kept in the choice and prune the children that can not beat the lb.
+  int or_order_depth;
+  size_t or_order_nodes;
+  size_t or_order_bounds;
+  double or_order_time; // seconds
+  size_t or_order_prunes; // counted by the brancher
+  
+  // context caching (AND/OR search graph): the value of the OR node at a
+  // position is stored under its context (position, context_f, and the
+  // evidence in context_bn), normalised to the expected future utility, and
+  // reused for any node with that context.
+  bool context_on;
+  ContextFunction context_f; // set in the CP model, if any
+  // parents of each BN variable (see read_net_parents()), empty if unknown;
+  // set before init_bndata(), which derives context_bn from them
+  vector< vector<int> > bn_parents;
+  // per position: the AND nodes before it (index in and_positions) that the
+  // distribution of the later AND nodes depends on, all if bn_parents is empty
+  vector< vector<int> > context_bn;
+  size_t context_hits;
+  size_t context_prunes; // upper bound in the cache below the lower bound
+  size_t context_misses;
+  size_t context_flushes;
+  static const size_t context_cache_size = 1<<20; // flushed when full
+  
+  // nogoods: a value of an OR node whose child failed in propagation is
+  // stored under the position, the value and the context of the decision
+  // (context_f at the start of its stage, and the values since). No BN
+  // evidence is part of it, so it is reused under the sibling values of the
+  // AND nodes above: the same child fails in commit, without propagating.
+  // A child failed if the brancher's next call after its commit is another
+  // commit, rather than choice() or new_leaf() (nogood_resolve()).
+  bool nogoods_on;
+  size_t nogood_hits;
+  size_t nogood_learned;
+  size_t nogood_flushes;
+  static const size_t nogood_store_size = 1<<20; // flushed when full
+  
+  // expected-utility propagator (see constraint_exputil.hpp): prunes the
+  // values of the next OR node whose bound_or() at depth prop_depth can not
+  // beat the lower bound the brancher will give that node; -1 if not posted
+  int prop_depth;
+  size_t prop_runs;
+  size_t prop_bounds;
+  size_t prop_prunes;
+  vector<int> prop_vals; // workspace of the propagator
+  
+  // workspace of the brancher's choice(), reserved in init_bndata()
+  vector< pair<int,double> > choice_scores;
+  vector< pair<int,int> > choice_evidence;
   
  private:
-  vector< pair<int,int> > varsmima; // overwrite at will, trick to avoid memory-allocating it each time
+  vector< pair<int,int> > varsmima; // for max_f_vars(), overwrite at will, trick to avoid memory-allocating it each time
   vector<pair<int, int> > leaf_evidence; // same reason as varsmima
-  double _bound_dfs(vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit);
+  vector< pair<int,int> > bound_evidence; // same reason, for bound_or() and bounds_and()
+  vector< pair<int,double> > leaf_partials; // same reason, for the leaves of the bound DFS
+  vector<int> dfs_pos, dfs_idx, dfs_sizem1; // same reason, for _bound_dfs_loop()
+  BoundCache bound_cache;
+  vector<int> bound_key_from; // nr_vars+1 entries, set by set_util()
+  bool _bound_cache_find(const vector< pair< int, int > >& varsmima, const vector< pair< int, int > >& evidence, int pos, int depth_limit, int util, double& v);
+  void _bound_cache_insert(const vector< pair< int, int > >& varsmima, const vector< pair< int, int > >& evidence, int pos, int depth_limit, int util, double v);
+  
+  BoundPool* bound_pool; // created on first use, NULL if sequential
+  vector<AceEngine*> bound_workspaces;
+  vector<PolTreeState*> bound_workers; // one per thread, sharing nothing with this one
+  // node of the split-up top of a parallel bound DFS
+  struct BoundTask {
+    vector< pair<int,int> > varsmima;
+    vector< pair<int,int> > evidence;
+    int pos;
+    int depth_limit;
+    int util;
+    int parent; // index in the previous level, -1 for the root
+    double v;
+  };
+  // the levels of the split, kept between calls with their vectors so that
+  // the split only allocates while it grows; level l holds bound_par_sizes[l] tasks
+  vector< vector<BoundTask> > bound_par_levels;
+  vector<size_t> bound_par_sizes;
+  bool _start_bound_pool();
+  bool _backup(int parent, double child_val);
+  double _bound_or(vector< pair<int,int> >& varsmima, int pos, int depth_limit);
+  
+  // context cache, values are normalised: value/pr(evidence) - past
+  struct ContextEntry {
+    double value; // min_inf if infeasible
+    bool exact; // else an upper bound (the subtree was pruned by its lower bound)
+  };
+  std::unordered_map<vector< pair<int,int> >, ContextEntry, int_vector_hasher> context_cache;
+  // subtrees under way, per position
+  struct OpenContext {
+    bool open;
+    vector< pair<int,int> > key;
+    double prob; // pr(evidence) of the node
+    int past;
+    double lb; // lower bound at the node
+  };
+  vector<OpenContext> context_open;
+  vector<int> context_ctx; // same reason as varsmima
+  vector< pair<int,int> > context_key; // same reason as varsmima
+  
+  std::unordered_set<vector< pair<int,int> >, int_vector_hasher> nogoods;
+  vector< pair<int,int> > nogood_key; // of the last OR commit
+  bool nogood_valid; // nogood_key is set
+  bool nogood_armed; // the child of nogood_key is being propagated
+  double _lp_value(vector< pair<int,int> >& varsmima);
+  
+  // bound kernels, specialised on the type of the utility functor
+  double (PolTreeState::*bound_dfs_fn)(vector< pair< int, int > >&, vector< pair< int, int > >&, int, int);
+  void (PolTreeState::*bound_leaves_fn)(vector< pair< int, int > >&, int, vector< pair< int, double > >&);
+  template<class F>
+  double _bound_dfs_entry(vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit);
+  template<class F>
+  void _bound_leaves_entry(vector< pair< int, int > >& varsmima, int pos, vector< pair< int, double > >& vals);
+  template<class F>
+  double _bound_dfs(const F& f, vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit, int util);
+  template<class F>
+  double _bound_dfs_par(const F& f, vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit, int util);
+  template<class F>
+  void _bound_leaves(const F& f, vector< pair< int, int > >& varsmima, int pos, vector< pair< int, double > >& vals);
   double _bound_dfs_loop(vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit, const Gecode::ViewArray< Gecode::Int::IntView >& vars);
 };
 
+
+// the stored max_f is of type F unless it was overwritten afterwards
+template<class F>
+double PolTreeState::_bound_dfs_entry(vector< pair< int, int > >& varsmima, vector< pair< int, int > >& evidence, int pos, int depth_limit)
+{
+  const F* f = max_f.template target<F>();
+  if (bound_threads > 1 && depth_limit >= bound_par_min_depth && _start_bound_pool()) {
+    if (f == NULL)
+      return _bound_dfs_par(max_f, varsmima, evidence, pos, depth_limit, max_f(varsmima));
+    return _bound_dfs_par(*f, varsmima, evidence, pos, depth_limit, (*f)(varsmima));
+  }
+  if (f == NULL)
+    return _bound_dfs(max_f, varsmima, evidence, pos, depth_limit, max_f(varsmima));
+  return _bound_dfs(*f, varsmima, evidence, pos, depth_limit, (*f)(varsmima));
+}
+
+template<class F>
+void PolTreeState::_bound_leaves_entry(vector< pair< int, int > >& varsmima, int pos, vector< pair< int, double > >& vals)
+{
+  const F* f = max_f.template target<F>();
+  if (f == NULL)
+    _bound_leaves(max_f, varsmima, pos, vals);
+  else
+    _bound_leaves(*f, varsmima, pos, vals);
+}
+
+// replace vals' second from prob to prob*util, with vars[pos]=val
+template<class F>
+void PolTreeState::_bound_leaves(const F& f,
+                                 vector< pair<int,int> >& varsmima,
+                                 int pos,
+                                 vector< pair< int, double > >& vals)
+{
+  pair<int,int> mima = varsmima[pos];
+  int util_mima = f(varsmima);
+  for (size_t i=0; i!=vals.size(); i++) {
+    int val = vals[i].first;
+    double prob = vals[i].second;
+    varsmima[pos].first = val; varsmima[pos].second = val;
+    int util = UtilUpdate<F>::apply(f, varsmima, pos, mima, util_mima);
+    if (verbose >= 5)
+      std::cout << "vars["<<pos<<"]="<<val<<": util*prob = "<<util*prob<<" = "<<util<<" * "<<prob<<"\n";
+    
+    vals[i].second = util*prob;
+  }
+}
+
+template<class F>
+double PolTreeState::_bound_dfs(const F& f,
+                                vector< pair<int,int> >& varsmima,
+                                vector< pair<int,int> >& evidence,
+                                int pos,
+                                int depth_limit,
+                                int util_mima) // = f(varsmima)
+{
+  pos = next_and[pos];
+  if (verbose >= 4) {
+    std::cout << "_bound_dfs(vmm,ev,"<<pos<<","<<depth_limit<<")\n";
+    std::cout << "varsmima, depth="<<depth<<":";
+    for (size_t i=0; i!=varsmima.size(); i++)
+      std::cout << " " << varsmima[i].first << "," << varsmima[i].second;
+    std::cout << "\n";
+    std::cout << "evidence:";
+    for (size_t i=0; i!=evidence.size(); i++)
+      std::cout << " " << evidence[i].first << "," << evidence[i].second;
+    std::cout << "\n";
+  }
+  assert(depth_limit > 0);
+  pair<int,int> mima = varsmima[pos]; // restored before returning
+  
+  if (depth_limit == 1) {
+    double v = 0;
+    bn.var_partials(evidence, varBNid[pos], leaf_partials);
+    const vector< pair<int,double> >& probs = leaf_partials;
+    for (size_t i=0; i!=probs.size(); i++) {
+      int val = probs[i].first;
+      double prob = probs[i].second;
+      varsmima[pos].first = val; varsmima[pos].second = val;
+      int util = UtilUpdate<F>::apply(f, varsmima, pos, mima, util_mima);
+      if (verbose >= 5)
+        std::cout << "Leaf! vars["<<pos<<"]="<<val<<": util*prob = "<<util*prob<<" = "<<util<<" * "<<prob<<"\n";
+      v += util*prob;
+    }
+    varsmima[pos] = mima;
+    return v;
+  }
+  
+  // same prefix and same ranges seen before?
+  double v = 0;
+  if (_bound_cache_find(varsmima, evidence, pos, depth_limit, util_mima, v))
+    return v;
+  
+  // else: dive down
+  size_t s = evidence.size();
+  evidence.push_back( std::make_pair(varBNid[pos], -1) ); // random val, will be overwritten
+  const vector< vector<int> >* val_ids = bn.get_val_ids();
+  for (auto val : val_ids->at(varBNid[pos])) {
+    varsmima[pos].first = val; varsmima[pos].second = val;
+    evidence[s].second = val;
+    int util = UtilUpdate<F>::apply(f, varsmima, pos, mima, util_mima);
+    v += _bound_dfs(f, varsmima, evidence, pos+1, depth_limit-1, util);
+  }
+  evidence.pop_back();
+  varsmima[pos] = mima;
+  
+  _bound_cache_insert(varsmima, evidence, pos, depth_limit, util_mima, v);
+  return v;
+}
+
+// Same value as _bound_dfs: the top levels are expanded breadth-first until
+// there are enough subtrees for the workers, the subtrees are evaluated in
+// parallel and the sums are formed in the same order as the sequential DFS.
+template<class F>
+double PolTreeState::_bound_dfs_par(const F& f,
+                                    vector< pair<int,int> >& varsmima,
+                                    vector< pair<int,int> >& evidence,
+                                    int pos,
+                                    int depth_limit,
+                                    int util_mima)
+{
+  double v = 0;
+  if (_bound_cache_find(varsmima, evidence, pos, depth_limit, util_mima, v))
+    return v;
+  
+  const vector< vector<int> >* val_ids = bn.get_val_ids();
+  vector< vector<BoundTask> >& levels = bound_par_levels;
+  vector<size_t>& sizes = bound_par_sizes;
+  if (levels.empty())
+    levels.resize(1);
+  if (levels[0].empty())
+    levels[0].resize(1);
+  sizes.assign(1, 1);
+  BoundTask& root = levels[0][0];
+  root.varsmima.assign(varsmima.begin(), varsmima.end());
+  root.evidence.assign(evidence.begin(), evidence.end());
+  root.pos = pos;
+  root.depth_limit = depth_limit;
+  root.util = util_mima;
+  root.parent = -1;
+  root.v = 0;
+  // leave at least two levels to each task, and the leaf kernel
+  size_t l = 0;
+  while (sizes[l] < 2*bound_pool->size() && levels[l][0].depth_limit >= 3) {
+    if (levels.size() == l+1)
+      levels.resize(l+2);
+    vector<BoundTask>& prev = levels[l];
+    vector<BoundTask>& next = levels[l+1];
+    size_t n = 0;
+    for (size_t t=0; t!=sizes[l]; t++) {
+      int p = next_and[prev[t].pos];
+      for (auto val : val_ids->at(varBNid[p])) {
+        if (next.size() == n)
+          next.resize(n+1);
+        BoundTask& child = next[n++];
+        child.varsmima.assign(prev[t].varsmima.begin(), prev[t].varsmima.end());
+        child.varsmima[p].first = val; child.varsmima[p].second = val;
+        child.evidence.assign(prev[t].evidence.begin(), prev[t].evidence.end());
+        child.evidence.push_back( std::make_pair(varBNid[p], val) );
+        child.pos = p+1;
+        child.depth_limit = prev[t].depth_limit-1;
+        child.util = UtilUpdate<F>::apply(f, child.varsmima, p, prev[t].varsmima[p], prev[t].util);
+        child.parent = t;
+        child.v = 0;
+      }
+    }
+    sizes.push_back(n);
+    l++;
+  }
+  
+  // captures no more than std::function stores in place
+  bound_par_calls++;
+  bound_par_tasks += sizes[l];
+  bound_pool->run(sizes[l], [this,&f](size_t t, size_t w) {
+    BoundTask& task = bound_par_levels[bound_par_sizes.size()-1][t];
+    task.v = bound_workers[w]->_bound_dfs(f, task.varsmima, task.evidence, task.pos, task.depth_limit, task.util);
+  });
+  
+  // sum bottom-up, children are in value order
+  for (; l!=0; l--)
+    for (size_t t=0; t!=sizes[l]; t++)
+      levels[l-1][levels[l][t].parent].v += levels[l][t].v;
+  v = levels[0][0].v;
+  
+  _bound_cache_insert(varsmima, evidence, pos, depth_limit, util_mima, v);
+  return v;
+}
@@ -0,0 +1,172 @@
+#ifndef POLICY_WRITER_HPP
+#define POLICY_WRITER_HPP
+
+#include <vector>
+#include <string>
+#include <utility>
+#include <algorithm>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <gecode/int.hh>
+
+using std::vector;
+using std::string;
+
+// Writes the optimal policy as JSON lines, one per OR node of the policy:
+//   {"pos":3,"evidence":[[bn_id,val],...],"decision":2}
+// i.e. the value to choose at position pos after observing that evidence
+// (the AND nodes before pos). Lines are in post-order.
+//
+// Nothing is kept in memory but a few offsets per position: the policy of
+// the subtree under way is written to the end of the file, and each OR node
+// keeps its best child's policy at the start of its own region:
+//   [begin, child) policy of the best child so far
+//   [child, end)   policy of the current child
+// When the current child is done (a commit at or above its position), it
+// is moved down over the old best if it improved the node, else the file
+// is cut back to 'child'. An AND node's region is that of its children in
+// sequence. So a discarded alternative is dropped as soon as it is done,
+// and when the search ends the file holds exactly the optimal policy.
+class PolicyWriter {
+ public:
+  PolicyWriter(const string& filename0) : filename(filename0), records(0), moved(0), failed(false) {
+    fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    end = 0;
+  }
+  ~PolicyWriter() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+  bool ok() const { return fd >= 0; }
+
+  void init(const vector<int>& varBNid);
+  // values of the leaf, before it is backed up
+  void leaf(const Gecode::IntVarArray& vars) {
+    for (int i=0; i!=vars.size(); i++)
+      path[i] = vars[i].val();
+  }
+  // a leaf improved the OR node at pos
+  void improved(int pos) { levels[pos].improved = true; }
+  // a commit at pos: the subtrees below pos and the current child of pos are done
+  void commit(int pos);
+  // after the search, cuts the file to the policy (empty if infeasible);
+  // false if that or any write before failed
+  bool finish(bool feasible);
+
+  const string filename;
+  size_t records; // lines written, including discarded ones
+  size_t moved; // bytes moved
+
+ private:
+  struct Level {
+    int bn_id;
+    off_t begin;
+    off_t child;
+    bool improved; // the current child is the best so far
+  };
+  vector<Level> levels;
+  vector<int> path; // values of the last leaf
+  int fd;
+  off_t end;
+  bool failed; // a write failed, the file is no policy anymore
+  string line; // same reason as varsmima
+
+  void _close_child(int pos);
+  bool _move(off_t from, off_t to, off_t len);
+};
+
+inline
+void PolicyWriter::init(const vector<int>& varBNid)
+{
+  levels.resize(varBNid.size());
+  for (size_t i=0; i!=levels.size(); i++) {
+    levels[i].bn_id = varBNid[i];
+    levels[i].begin = 0;
+    levels[i].child = 0;
+    levels[i].improved = false;
+  }
+  path.assign(varBNid.size(), 0);
+}
+
+inline
+void PolicyWriter::commit(int pos)
+{
+  for (int i=levels.size()-1; i>=pos; i--)
+    _close_child(i);
+  // the nodes below pos will start at the end
+  for (size_t i=pos+1; i<levels.size(); i++) {
+    levels[i].begin = end;
+    levels[i].child = end;
+  }
+  levels[pos].child = end;
+}
+
+inline
+void PolicyWriter::_close_child(int pos)
+{
+  Level& l = levels[pos];
+  if (l.bn_id != -1) // AND: the policies of the children follow each other
+    return;
+  if (!l.improved) {
+    end = l.child;
+    return;
+  }
+  l.improved = false;
+  if (failed)
+    return;
+  line = "{\"pos\":" + std::to_string(pos) + ",\"evidence\":[";
+  bool first = true;
+  for (int i=0; i!=pos; i++) {
+    if (levels[i].bn_id == -1)
+      continue;
+    if (!first)
+      line += ',';
+    first = false;
+    line += '[' + std::to_string(levels[i].bn_id) + ',' + std::to_string(path[i]) + ']';
+  }
+  line += "],\"decision\":" + std::to_string(path[pos]) + "}\n";
+  if (::pwrite(fd, line.data(), line.size(), end) != (ssize_t)line.size()) {
+    failed = true;
+    return;
+  }
+  end += line.size();
+  records++;
+  // replaces the previous best
+  off_t len = end - l.child;
+  if (l.child != l.begin && !_move(l.child, l.begin, len)) {
+    failed = true;
+    return;
+  }
+  end = l.begin + len;
+  l.child = end;
+}
+
+// from > to, forwards in chunks
+inline
+bool PolicyWriter::_move(off_t from, off_t to, off_t len)
+{
+  char buf[1<<16];
+  moved += len;
+  while (len > 0) {
+    ssize_t n = ::pread(fd, buf, std::min<off_t>(len, sizeof(buf)), from);
+    if (n <= 0 || ::pwrite(fd, buf, n, to) != n)
+      return false;
+    from += n;
+    to += n;
+    len -= n;
+  }
+  return true;
+}
+
+inline
+bool PolicyWriter::finish(bool feasible)
+{
+  if (!levels.empty())
+    commit(0);
+  if (!feasible)
+    end = 0;
+  return ::ftruncate(fd, end) == 0 && !failed;
+}
+
+#endif //POLICY_WRITER_HPP